@@ -24,6 +24,11 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Dynamic tick. */
+void timer_idle (void);
+void timer_resume (void);
+
+void timer_interrupt_stats (int64_t *cnt, uint64_t *cycles);
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,303 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Slots in a table's first array. */
+#define MIN_SLOTS 16
+
+/* Old slots examined by each insertion or deletion while the
+   table grows.  An array of N slots holding 3N/4 elements is
+   replaced by one of 2N slots, which takes another 3N/4
+   insertions to fill.  Those must visit all N old slots and move
+   up to 3N/4 elements, or 7N/4 steps, so 4 per insertion is
+   enough. */
+#define MOVE_STEPS 4
+
+static unsigned hash_key (uintptr_t key);
+static struct ohash_slot *find_slot (struct ohash_slot *, size_t slot_cnt,
+                                     uintptr_t key, unsigned hash);
+static void put_slot (struct ohash_slot *, size_t slot_cnt,
+                      struct ohash_slot);
+static void remove_slot (struct ohash_slot *, size_t slot_cnt, size_t idx);
+static bool grow (struct ohash *);
+static void move_elems (struct ohash *, size_t step_cnt);
+static void drop_old_slots (struct ohash *);
+
+/* Initializes H as an empty table.  No memory is allocated until
+   the first insertion. */
+void
+ohash_init (struct ohash *h)
+{
+  h->elem_cnt = 0;
+  h->slots = NULL;
+  h->slot_cnt = 0;
+  h->old_slots = NULL;
+  h->old_slot_cnt = 0;
+  h->old_elem_cnt = 0;
+  h->move_idx = 0;
+}
+
+/* Destroys table H, first calling DESTRUCTOR, if it is non-null,
+   for each element.  DESTRUCTOR must not modify H.  H is empty
+   afterward and may be used again. */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *destructor)
+{
+  size_t i;
+
+  if (destructor != NULL)
+    {
+      for (i = 0; i < h->slot_cnt; i++)
+        if (h->slots[i].hash != 0)
+          destructor (h->slots[i].key, h->slots[i].value);
+      for (i = 0; i < h->old_slot_cnt; i++)
+        if (h->old_slots[i].hash != 0)
+          destructor (h->old_slots[i].key, h->old_slots[i].value);
+    }
+
+  free (h->slots);
+  free (h->old_slots);
+  ohash_init (h);
+}
+
+/* Returns the value that H maps KEY to, or a null pointer if H
+   does not contain KEY. */
+void *
+ohash_find (const struct ohash *h, uintptr_t key)
+{
+  unsigned hash = hash_key (key);
+  struct ohash_slot *s = find_slot (h->slots, h->slot_cnt, key, hash);
+
+  if (s == NULL)
+    s = find_slot (h->old_slots, h->old_slot_cnt, key, hash);
+  return s != NULL ? s->value : NULL;
+}
+
+/* Maps KEY to VALUE, which must not be null, in H.  Returns
+   false if H already contains KEY or memory is exhausted. */
+bool
+ohash_insert (struct ohash *h, uintptr_t key, void *value)
+{
+  struct ohash_slot e;
+
+  ASSERT (value != NULL);
+
+  if (ohash_find (h, key) != NULL)
+    return false;
+
+  /* Keep the load below 3/4.  If the table cannot grow, fill it
+     further, but always leave a slot empty so that probes end. */
+  if ((h->elem_cnt + 1) * 4 > h->slot_cnt * 3
+      && !grow (h) && h->elem_cnt + 1 >= h->slot_cnt)
+    return false;
+
+  e.hash = hash_key (key);
+  e.key = key;
+  e.value = value;
+  put_slot (h->slots, h->slot_cnt, e);
+  h->elem_cnt++;
+  move_elems (h, MOVE_STEPS);
+  return true;
+}
+
+/* Removes KEY from H and returns the value it was mapped to, or
+   a null pointer if H does not contain KEY. */
+void *
+ohash_delete (struct ohash *h, uintptr_t key)
+{
+  unsigned hash = hash_key (key);
+  struct ohash_slot *s;
+  void *value;
+
+  s = find_slot (h->slots, h->slot_cnt, key, hash);
+  if (s != NULL)
+    {
+      value = s->value;
+      remove_slot (h->slots, h->slot_cnt, s - h->slots);
+    }
+  else
+    {
+      s = find_slot (h->old_slots, h->old_slot_cnt, key, hash);
+      if (s == NULL)
+        return NULL;
+      value = s->value;
+      remove_slot (h->old_slots, h->old_slot_cnt, s - h->old_slots);
+      if (--h->old_elem_cnt == 0)
+        drop_old_slots (h);
+    }
+  h->elem_cnt--;
+  move_elems (h, MOVE_STEPS);
+  return value;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (const struct ohash *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns a hash of KEY, never 0.  Page addresses differ only
+   in their upper bits, so mix those into the lower bits that
+   pick the home slot (MurmurHash3's finalizer). */
+static unsigned
+hash_key (uintptr_t key)
+{
+  unsigned hash = key;
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash != 0 ? hash : 1;
+}
+
+/* Returns how far slot IDX of an array of SLOT_CNT slots lies
+   past the home slot of HASH. */
+static size_t
+probe_dist (unsigned hash, size_t idx, size_t slot_cnt)
+{
+  return (idx - hash) & (slot_cnt - 1);
+}
+
+/* Returns the slot holding KEY, whose hash is HASH, in the
+   SLOT_CNT slots of SLOTS, or a null pointer if there is none. */
+static struct ohash_slot *
+find_slot (struct ohash_slot *slots, size_t slot_cnt,
+           uintptr_t key, unsigned hash)
+{
+  size_t idx, dist;
+
+  if (slot_cnt == 0)
+    return NULL;
+
+  for (idx = hash & (slot_cnt - 1), dist = 0; ;
+       idx = (idx + 1) & (slot_cnt - 1), dist++)
+    {
+      struct ohash_slot *s = &slots[idx];
+      if (s->hash == 0 || probe_dist (s->hash, idx, slot_cnt) < dist)
+        return NULL;
+      if (s->hash == hash && s->key == key)
+        return s;
+    }
+}
+
+/* Puts E into the SLOT_CNT slots of SLOTS, which must not
+   contain its key and must have an empty slot. */
+static void
+put_slot (struct ohash_slot *slots, size_t slot_cnt, struct ohash_slot e)
+{
+  size_t idx, dist;
+
+  for (idx = e.hash & (slot_cnt - 1), dist = 0; ;
+       idx = (idx + 1) & (slot_cnt - 1), dist++)
+    {
+      struct ohash_slot *s = &slots[idx];
+      size_t s_dist;
+
+      if (s->hash == 0)
+        {
+          *s = e;
+          return;
+        }
+
+      /* Take the slot from an element closer to its home. */
+      s_dist = probe_dist (s->hash, idx, slot_cnt);
+      if (s_dist < dist)
+        {
+          struct ohash_slot displaced = *s;
+          *s = e;
+          e = displaced;
+          dist = s_dist;
+        }
+    }
+}
+
+/* Empties slot IDX of the SLOT_CNT slots of SLOTS, shifting back
+   the elements after it that are not in their home slots. */
+static void
+remove_slot (struct ohash_slot *slots, size_t slot_cnt, size_t idx)
+{
+  for (;;)
+    {
+      size_t next = (idx + 1) & (slot_cnt - 1);
+      struct ohash_slot *s = &slots[next];
+
+      if (s->hash == 0 || probe_dist (s->hash, next, slot_cnt) == 0)
+        {
+          slots[idx].hash = 0;
+          return;
+        }
+      slots[idx] = *s;
+      idx = next;
+    }
+}
+
+/* Replaces H's slots by twice as many, to be filled from the old
+   ones by move_elems().  Returns false if memory is exhausted. */
+static bool
+grow (struct ohash *h)
+{
+  size_t slot_cnt = h->slot_cnt != 0 ? h->slot_cnt * 2 : MIN_SLOTS;
+  struct ohash_slot *slots;
+
+  /* Finish the last resize first. */
+  move_elems (h, SIZE_MAX);
+
+  slots = calloc (slot_cnt, sizeof *slots);
+  if (slots == NULL)
+    return false;
+
+  h->old_slots = h->slots;
+  h->old_slot_cnt = h->slot_cnt;
+  h->old_elem_cnt = h->elem_cnt;
+  h->move_idx = 0;
+  h->slots = slots;
+  h->slot_cnt = slot_cnt;
+  if (h->old_elem_cnt == 0)
+    drop_old_slots (h);
+  return true;
+}
+
+/* Moves elements of H from its old slots to its current ones,
+   examining at most STEP_CNT old slots.
+
+   Elements are taken in slot order and the cluster behind each
+   one shifts back into its slot, so every old slot below
+   `move_idx' stays empty and every element still in the old
+   slots is reached from its home slot by probing. */
+static void
+move_elems (struct ohash *h, size_t step_cnt)
+{
+  for (; h->old_slots != NULL && step_cnt > 0; step_cnt--)
+    {
+      struct ohash_slot *s = &h->old_slots[h->move_idx];
+
+      if (s->hash == 0)
+        {
+          h->move_idx++;
+          continue;
+        }
+      put_slot (h->slots, h->slot_cnt, *s);
+      remove_slot (h->old_slots, h->old_slot_cnt, h->move_idx);
+      if (--h->old_elem_cnt == 0)
+        drop_old_slots (h);
+    }
+}
+
+/* Frees H's old slots, which must be empty. */
+static void
+drop_old_slots (struct ohash *h)
+{
+  ASSERT (h->old_elem_cnt == 0);
+
+  free (h->old_slots);
+  h->old_slots = NULL;
+  h->old_slot_cnt = 0;
+  h->move_idx = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   Maps word-sized keys, such as page addresses, to non-null
+   pointers.  Unlike struct hash, the elements live inline in a
+   single array of slots that holds each key together with its
+   hash value and its value, so a lookup usually touches one or
+   two cache lines instead of chasing list pointers through the
+   heap, and the objects mapped need not embed any element.
+
+   Collisions are resolved by linear probing with Robin Hood
+   insertion: an element being inserted takes the slot of any
+   element it meets that sits closer to its own home slot, and
+   that element moves on instead.  This keeps probe sequences
+   short and even, and lets a failed lookup stop as soon as it
+   meets an element closer to home than the key would be.
+   Deletion shifts the rest of the cluster back by one slot, so
+   there are no tombstones.
+
+   Growing does not rehash every element at once.  Insertions go
+   to a new array of twice the size, and every insertion or
+   deletion moves a few elements over from the old array until it
+   is empty.  Lookups search both arrays meanwhile.  Lookups never
+   modify the table. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A slot in an open-addressing hash table. */
+struct ohash_slot
+  {
+    unsigned hash;              /* Hash of KEY, or 0 if empty. */
+    uintptr_t key;              /* Key. */
+    void *value;                /* Value, never null. */
+  };
+
+/* Open-addressing hash table. */
+struct ohash
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+    size_t slot_cnt;            /* Number of slots, a power of 2, or 0. */
+    struct ohash_slot *old_slots; /* Array being emptied, or null. */
+    size_t old_slot_cnt;        /* Number of slots in `old_slots'. */
+    size_t old_elem_cnt;        /* Elements left in `old_slots'. */
+    size_t move_idx;            /* `old_slots' is empty below this. */
+  };
+
+/* Performs some operation on the element mapping KEY to VALUE. */
+typedef void ohash_action_func (uintptr_t key, void *value);
+
+/* Basic life cycle. */
+void ohash_init (struct ohash *);
+void ohash_destroy (struct ohash *, ohash_action_func *);
+
+/* Search, insertion, deletion. */
+void *ohash_find (const struct ohash *, uintptr_t key);
+bool ohash_insert (struct ohash *, uintptr_t key, void *value);
+void *ohash_delete (struct ohash *, uintptr_t key);
+
+/* Information. */
+size_t ohash_size (const struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
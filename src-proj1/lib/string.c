@@ -1,5 +1,27 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below move data a 32-bit word at a time
+   once the block is big enough to pay for lining up the
+   destination on a word boundary, which is where rep movsl and
+   rep stosl run fastest.  x86 allows the unaligned word loads
+   that this leaves on the source side.
+
+   Words are accessed through this type, which may alias any
+   other, so that the compiler does not assume the bytes behind it
+   are unrelated to the ones written through char pointers. */
+typedef uint32_t __attribute__ ((may_alias)) word_t;
+
+/* Blocks shorter than this are copied or set a byte at a time. */
+#define WORD_MIN 16
+
+/* Returns the number of bytes from P to the next word boundary. */
+static inline size_t
+word_gap (const void *p) 
+{
+  return -(uintptr_t) p & (sizeof (word_t) - 1);
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +34,21 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_MIN) 
+    {
+      size_t head = word_gap (dst);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = *src++;
+
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+    }
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -58,6 +95,11 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, then find the differing byte. */
+  for (; size >= sizeof (word_t); a += sizeof (word_t), b += sizeof (word_t),
+         size -= sizeof (word_t))
+    if (*(const word_t *) a != *(const word_t *) b)
+      break;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,7 +323,24 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
+
+  if (size >= WORD_MIN) 
+    {
+      size_t head = word_gap (dst);
+      word_t word = (unsigned char) value * (word_t) 0x01010101;
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = value;
+
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" (word)
+                    : "memory");
+    }
   while (size-- > 0)
     *dst++ = value;
 
@@ -293,10 +352,20 @@ size_t
 strlen (const char *string) 
 {
   const char *p;
+  const word_t *w;
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
+  /* Check bytes up to a word boundary, then whole words.  An
+     aligned word never crosses a page boundary, so reading past
+     the null terminator within its word is safe. */
+  for (p = string; word_gap (p) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+  for (w = (const word_t *) p; ; w++)
+    if ((*w - 0x01010101) & ~*w & 0x80808080)
+      break;
+  for (p = (const char *) w; *p != '\0'; p++)
     continue;
   return p - string;
 }
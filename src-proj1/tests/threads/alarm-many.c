@@ -0,0 +1,93 @@
+/* Puts 1000 threads to sleep at once and checks that none of
+   them wakes up early.  Also reports the average time the timer
+   interrupt handler takes with no thread asleep and with all
+   1000 asleep.  The handler only looks at the front of the sleep
+   queue, so the two should be about the same. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+
+struct sleeper 
+  {
+    int64_t wakeup;             /* Tick to wake up at. */
+    bool early;                 /* Woke up before WAKEUP? */
+  };
+
+static thread_func sleeper_func;
+static void report (const char *what);
+
+static struct semaphore done;
+
+void
+test_alarm_many (void) 
+{
+  struct sleeper *sleepers;
+  int64_t start;
+  int i, early_cnt;
+
+  sleepers = malloc (sizeof *sleepers * THREAD_CNT);
+  if (sleepers == NULL)
+    PANIC ("couldn't allocate memory for test");
+  sema_init (&done, 0);
+
+  report ("0 threads asleep");
+
+  /* All sleepers are due between 1 and 2 seconds from now, well
+     after the second report. */
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      s->wakeup = start + TIMER_FREQ + i % TIMER_FREQ;
+      s->early = false;
+      if (thread_create ("sleeper", PRI_DEFAULT, sleeper_func, s) == TID_ERROR)
+        fail ("could not create sleeper %d", i);
+    }
+
+  report ("1000 threads asleep");
+
+  early_cnt = 0;
+  for (i = 0; i < THREAD_CNT; i++) 
+    sema_down (&done);
+  for (i = 0; i < THREAD_CNT; i++) 
+    if (sleepers[i].early)
+      early_cnt++;
+  if (early_cnt > 0)
+    fail ("%d threads woke up early", early_cnt);
+  msg ("all %d threads woke up on time", THREAD_CNT);
+
+  free (sleepers);
+}
+
+/* Sleeps for a while and prints WHAT and the average number of
+   CPU cycles each timer interrupt took meanwhile. */
+static void
+report (const char *what) 
+{
+  int64_t cnt0, cnt1;
+  uint64_t cycles0, cycles1;
+
+  timer_interrupt_stats (&cnt0, &cycles0);
+  timer_sleep (TIMER_FREQ / 10);
+  timer_interrupt_stats (&cnt1, &cycles1);
+  msg ("%s: %"PRIu64" cycles per timer interrupt",
+       what, (cycles1 - cycles0) / (cnt1 - cnt0));
+}
+
+static void
+sleeper_func (void *s_) 
+{
+  struct sleeper *s = s_;
+
+  timer_sleep (s->wakeup - timer_ticks ());
+  s->early = timer_ticks () < s->wakeup;
+  sema_up (&done);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+# The cycle counts vary from run to run.
+my (@core) = grep (/^\(alarm-many\) /, @output);
+s/: \d+ cycles/: N cycles/ foreach @core;
+
+my (@expected) = ("(alarm-many) begin",
+		  "(alarm-many) 0 threads asleep: N cycles per timer interrupt",
+		  "(alarm-many) 1000 threads asleep: N cycles per timer interrupt",
+		  "(alarm-many) all 1000 threads woke up on time",
+		  "(alarm-many) end");
+fail "Output differs from expected:\n" . join ("\n", @core) . "\n"
+  if join ("\n", @core) ne join ("\n", @expected);
+
+pass;
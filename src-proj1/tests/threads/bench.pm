@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+
+# Checks the output of a benchmark.  Timings vary from run to
+# run, so this only checks that the run was clean and that
+# $expected lines, without the "(name) " prefix, match $pattern.
+sub check_bench {
+    my ($expected, $pattern) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my ($name) = $test =~ m%([^/]+)$%;
+    my (@lines) = grep (/^\(\Q$name\E\) $pattern$/, @output);
+    fail scalar (@lines) . " measurements found, $expected expected\n"
+      if @lines != $expected;
+    pass;
+}
+
+1;
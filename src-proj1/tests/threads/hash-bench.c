@@ -0,0 +1,289 @@
+/* Times the chained hash table of lib/kernel/hash.c against the
+   open-addressing one of lib/kernel/ohash.c and the radix tree of
+   lib/kernel/radix.c on the access pattern
+   of a supplemental page table: a process's pages are inserted,
+   looked up at random the way page faults look them up, with
+   some lookups missing as on stack growth, and deleted again.
+
+   Each table size builds and tears down enough tables to insert
+   the same total number of pages, and does the same number of
+   lookups, so the times of different sizes compare. */
+
+#include <hash.h>
+#include <inttypes.h>
+#include <ohash.h>
+#include <radix.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Pages inserted per table size, over all rounds. */
+#define TOTAL_PAGES 65536
+
+/* Lookups per table size, over all rounds. */
+#define LOOKUP_CNT 1000000
+
+/* One lookup in MISS_RATE is for a page not in the table. */
+#define MISS_RATE 8
+
+/* A page, as kept in a chained hash table. */
+struct page
+  {
+    void *upage;                /* User page address. */
+    struct hash_elem elem;      /* Element in the table. */
+  };
+
+/* Ticks spent inserting, looking up, and deleting. */
+struct timing
+  {
+    int64_t insert, find, delete;
+  };
+
+static struct page *pages;
+static void **keys;
+
+static size_t run_hash (size_t page_cnt, struct timing *);
+static size_t run_ohash (size_t page_cnt, struct timing *);
+static size_t run_radix (size_t page_cnt, struct timing *);
+static void *page_addr (size_t idx);
+static unsigned page_hash (const struct hash_elem *, void *aux);
+static bool page_less (const struct hash_elem *, const struct hash_elem *,
+                       void *aux);
+
+void
+test_hash_bench (void)
+{
+  static const size_t sizes[] = {64, 512, 4096};
+  size_t max_pages = sizes[sizeof sizes / sizeof *sizes - 1];
+  size_t s, i;
+
+  pages = malloc (max_pages * sizeof *pages);
+  keys = malloc (LOOKUP_CNT / (TOTAL_PAGES / max_pages) * sizeof *keys);
+  if (pages == NULL || keys == NULL)
+    fail ("out of memory for page records");
+
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    {
+      size_t page_cnt = sizes[s];
+      struct timing chained, open, tree;
+      size_t chained_hits, open_hits, tree_hits;
+
+      for (i = 0; i < page_cnt; i++)
+        pages[i].upage = page_addr (i);
+
+      chained_hits = run_hash (page_cnt, &chained);
+      open_hits = run_ohash (page_cnt, &open);
+      tree_hits = run_radix (page_cnt, &tree);
+      if (chained_hits != open_hits || chained_hits != tree_hits)
+        fail ("%zu pages: hash found %zu pages, ohash %zu, radix %zu",
+              page_cnt, chained_hits, open_hits, tree_hits);
+      msg ("%zu pages: hash %"PRId64"/%"PRId64"/%"PRId64" ticks, "
+           "ohash %"PRId64"/%"PRId64"/%"PRId64" ticks, "
+           "radix %"PRId64"/%"PRId64"/%"PRId64" ticks "
+           "(insert/find/delete)", page_cnt,
+           chained.insert, chained.find, chained.delete,
+           open.insert, open.find, open.delete,
+           tree.insert, tree.find, tree.delete);
+    }
+
+  free (keys);
+  free (pages);
+}
+
+/* Returns the user address of the IDX-th page of a process:
+   mostly contiguous runs, like code, data, and stack. */
+static void *
+page_addr (size_t idx)
+{
+  uintptr_t base = idx % 4 == 3 ? (uintptr_t) PHYS_BASE - 0x10000000
+                                : 0x08048000;
+  return (void *) (base + idx * PGSIZE);
+}
+
+/* Fills KEYS with CNT random lookups among PAGE_CNT pages, one in
+   MISS_RATE of them for a page not in the table. */
+static void
+pick_keys (size_t page_cnt, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    keys[i] = (random_ulong () % MISS_RATE == 0
+               ? page_addr (page_cnt + random_ulong () % page_cnt)
+               : page_addr (random_ulong () % page_cnt));
+}
+
+/* Times a chained hash table of PAGE_CNT pages into *T.
+   Returns the number of lookups that found their page. */
+static size_t
+run_hash (size_t page_cnt, struct timing *t)
+{
+  size_t round_cnt = TOTAL_PAGES / page_cnt;
+  size_t lookup_cnt = LOOKUP_CNT / round_cnt;
+  size_t total_hits = 0;
+  size_t round, i;
+
+  t->insert = t->find = t->delete = 0;
+  random_init (0);
+  for (round = 0; round < round_cnt; round++)
+    {
+      struct hash h;
+      int64_t start;
+      size_t hits = 0;
+
+      if (!hash_init (&h, page_hash, page_less, NULL))
+        fail ("out of memory for hash table");
+      pick_keys (page_cnt, lookup_cnt);
+
+      start = timer_ticks ();
+      for (i = 0; i < page_cnt; i++)
+        if (hash_insert (&h, &pages[i].elem) != NULL)
+          fail ("hash: page %zu inserted twice", i);
+      t->insert += timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < lookup_cnt; i++)
+        {
+          struct page p;
+          struct hash_elem *e;
+
+          p.upage = keys[i];
+          e = hash_find (&h, &p.elem);
+          if (e != NULL && hash_entry (e, struct page, elem)->upage == keys[i])
+            hits++;
+        }
+      t->find += timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < page_cnt; i++)
+        if (hash_delete (&h, &pages[i].elem) == NULL)
+          fail ("hash: page %zu lost", i);
+      t->delete += timer_elapsed (start);
+
+      hash_destroy (&h, NULL);
+      if (hits == 0 || hits == lookup_cnt)
+        fail ("hash: %zu of %zu lookups hit", hits, lookup_cnt);
+      total_hits += hits;
+    }
+  return total_hits;
+}
+
+/* Times an open-addressing hash table of PAGE_CNT pages into *T.
+   Returns the number of lookups that found their page. */
+static size_t
+run_ohash (size_t page_cnt, struct timing *t)
+{
+  size_t round_cnt = TOTAL_PAGES / page_cnt;
+  size_t lookup_cnt = LOOKUP_CNT / round_cnt;
+  size_t total_hits = 0;
+  size_t round, i;
+
+  t->insert = t->find = t->delete = 0;
+  random_init (0);
+  for (round = 0; round < round_cnt; round++)
+    {
+      struct ohash h;
+      int64_t start;
+      size_t hits = 0;
+
+      ohash_init (&h);
+      pick_keys (page_cnt, lookup_cnt);
+
+      start = timer_ticks ();
+      for (i = 0; i < page_cnt; i++)
+        if (!ohash_insert (&h, (uintptr_t) pages[i].upage, &pages[i]))
+          fail ("ohash: page %zu not inserted", i);
+      t->insert += timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < lookup_cnt; i++)
+        {
+          struct page *p = ohash_find (&h, (uintptr_t) keys[i]);
+          if (p != NULL && p->upage == keys[i])
+            hits++;
+        }
+      t->find += timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < page_cnt; i++)
+        if (ohash_delete (&h, (uintptr_t) pages[i].upage) != &pages[i])
+          fail ("ohash: page %zu lost", i);
+      t->delete += timer_elapsed (start);
+
+      if (ohash_size (&h) != 0)
+        fail ("ohash: %zu pages left after deleting all", ohash_size (&h));
+      ohash_destroy (&h, NULL);
+      total_hits += hits;
+    }
+  return total_hits;
+}
+
+/* Times a radix tree of PAGE_CNT pages into *T.
+   Returns the number of lookups that found their page. */
+static size_t
+run_radix (size_t page_cnt, struct timing *t)
+{
+  size_t round_cnt = TOTAL_PAGES / page_cnt;
+  size_t lookup_cnt = LOOKUP_CNT / round_cnt;
+  size_t total_hits = 0;
+  size_t round, i;
+
+  t->insert = t->find = t->delete = 0;
+  random_init (0);
+  for (round = 0; round < round_cnt; round++)
+    {
+      struct radix_tree r;
+      int64_t start;
+      size_t hits = 0;
+
+      radix_init (&r);
+      pick_keys (page_cnt, lookup_cnt);
+
+      start = timer_ticks ();
+      for (i = 0; i < page_cnt; i++)
+        if (!radix_insert (&r, pg_no (pages[i].upage), &pages[i]))
+          fail ("radix: page %zu not inserted", i);
+      t->insert += timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < lookup_cnt; i++)
+        {
+          struct page *p = radix_lookup (&r, pg_no (keys[i]));
+          if (p != NULL && p->upage == keys[i])
+            hits++;
+        }
+      t->find += timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < page_cnt; i++)
+        if (radix_delete (&r, pg_no (pages[i].upage)) != &pages[i])
+          fail ("radix: page %zu lost", i);
+      t->delete += timer_elapsed (start);
+
+      if (radix_size (&r) != 0)
+        fail ("radix: %zu pages left after deleting all", radix_size (&r));
+      radix_destroy (&r, NULL);
+      total_hits += hits;
+    }
+  return total_hits;
+}
+
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED)
+{
+  const struct page *p = hash_entry (a, struct page, elem);
+  const struct page *q = hash_entry (b, struct page, elem);
+  return p->upage < q->upage;
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (3, qr/\d+ pages: hash \d+\/\d+\/\d+ ticks, ohash \d+\/\d+\/\d+ ticks, radix \d+\/\d+\/\d+ ticks \(insert\/find\/delete\)/);
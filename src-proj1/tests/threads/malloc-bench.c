@@ -0,0 +1,113 @@
+/* Replays a synthetic trace of kernel allocations through
+   malloc() and free() and reports how much of the memory handed
+   out was wasted inside blocks, how many kernel pages the live
+   blocks took, and how fast the trace ran.
+
+   The request sizes follow the objects the kernel allocates most:
+   small records such as file descriptors, frame and page table
+   entries, and inodes; sector-sized bounce buffers; and
+   occasional buffers of a page or more, such as argument copies
+   and bitmaps.  Each block lives for a random number of further
+   operations. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define OP_CNT 200000
+#define SLOT_CNT 512
+
+/* A request size and how often it occurs, out of 100. */
+struct request
+  {
+    size_t size;
+    int weight;
+  };
+
+static const struct request requests[] =
+  {
+    {8, 8}, {20, 12}, {36, 14}, {40, 14}, {52, 8}, {72, 6}, {100, 6},
+    {150, 5}, {300, 4}, {512, 10}, {700, 3}, {1100, 3}, {1600, 2},
+    {2500, 2}, {4096, 2}, {9000, 1},
+  };
+
+static size_t pick_size (void);
+
+void
+test_malloc_bench (void) 
+{
+  static void *blocks[SLOT_CNT];
+  static size_t sizes[SLOT_CNT];
+  struct palloc_stats stats;
+  size_t start_free, min_free;
+  uint64_t requested = 0, allocated = 0;
+  size_t live_requested = 0, peak_requested = 0;
+  int64_t start;
+  int i;
+
+  palloc_get_stats (0, &stats);
+  start_free = min_free = stats.free_cnt;
+
+  start = timer_ticks ();
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      int slot = random_ulong () % SLOT_CNT;
+
+      if (blocks[slot] != NULL) 
+        {
+          free (blocks[slot]);
+          blocks[slot] = NULL;
+          live_requested -= sizes[slot];
+        }
+      else 
+        {
+          sizes[slot] = pick_size ();
+          blocks[slot] = malloc (sizes[slot]);
+          if (blocks[slot] == NULL)
+            fail ("out of memory allocating %zu bytes", sizes[slot]);
+          requested += sizes[slot];
+          allocated += malloc_usable_size (blocks[slot]);
+          live_requested += sizes[slot];
+          if (live_requested > peak_requested)
+            peak_requested = live_requested;
+
+          palloc_get_stats (0, &stats);
+          if (stats.free_cnt < min_free)
+            min_free = stats.free_cnt;
+        }
+    }
+  msg ("%d operations in %"PRId64" ticks", OP_CNT, timer_elapsed (start));
+
+  for (i = 0; i < SLOT_CNT; i++)
+    free (blocks[i]);
+
+  msg ("internal fragmentation: %"PRIu64" of %"PRIu64" bytes allocated "
+       "(%"PRIu64"%%) unused", allocated - requested, allocated,
+       (allocated - requested) * 100 / allocated);
+  msg ("peak: %zu bytes requested in %zu kernel pages",
+       peak_requested, start_free - min_free);
+}
+
+/* Returns a request size drawn from REQUESTS. */
+static size_t
+pick_size (void) 
+{
+  int total = 0;
+  int r;
+  size_t i;
+
+  for (i = 0; i < sizeof requests / sizeof *requests; i++)
+    total += requests[i].weight;
+  r = random_ulong () % total;
+  for (i = 0; ; i++) 
+    {
+      r -= requests[i].weight;
+      if (r < 0)
+        return requests[i].size;
+    }
+}
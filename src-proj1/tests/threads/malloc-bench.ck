@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (3, qr/(\d+ operations in \d+ ticks|internal fragmentation: \d+ of \d+ bytes allocated \(\d+%\) unused|peak: \d+ bytes requested in \d+ kernel pages)/);
@@ -0,0 +1,68 @@
+/* Checks the page allocator's memory accounting: pages allocated
+   with a tag are counted under it until they are freed, the
+   tag's high-water mark stays behind afterward, and untagged
+   user pages count as user pages. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+
+#define PAGE_CNT 5
+#define BLOCK_PAGES 3
+
+void
+test_palloc_account (void) 
+{
+  struct palloc_stats before, during, after;
+  void *pages[PAGE_CNT];
+  void *block;
+  void *upage;
+  int i;
+
+  palloc_get_stats (0, &before);
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      pages[i] = palloc_get_page (PAL_ZERO | PAL_TAG (PAL_TAG_CACHE));
+      if (pages[i] == NULL)
+        fail ("out of kernel pages");
+    }
+  block = palloc_get_multiple (PAL_TAG (PAL_TAG_CACHE), BLOCK_PAGES);
+  if (block == NULL)
+    fail ("out of kernel pages");
+
+  palloc_get_stats (0, &during);
+  if (during.tag_cnt[PAL_TAG_CACHE]
+      != before.tag_cnt[PAL_TAG_CACHE] + PAGE_CNT + BLOCK_PAGES)
+    fail ("%zu cache pages counted, expected %zu",
+          during.tag_cnt[PAL_TAG_CACHE],
+          before.tag_cnt[PAL_TAG_CACHE] + PAGE_CNT + BLOCK_PAGES);
+  if (during.tag_peak[PAL_TAG_CACHE] < during.tag_cnt[PAL_TAG_CACHE])
+    fail ("cache peak %zu below current count %zu",
+          during.tag_peak[PAL_TAG_CACHE], during.tag_cnt[PAL_TAG_CACHE]);
+  msg ("allocated %d tagged pages", PAGE_CNT + BLOCK_PAGES);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+  palloc_free_multiple (block, BLOCK_PAGES);
+
+  palloc_get_stats (0, &after);
+  if (after.tag_cnt[PAL_TAG_CACHE] != before.tag_cnt[PAL_TAG_CACHE])
+    fail ("%zu cache pages counted after freeing, expected %zu",
+          after.tag_cnt[PAL_TAG_CACHE], before.tag_cnt[PAL_TAG_CACHE]);
+  msg ("freed them");
+  if (after.tag_peak[PAL_TAG_CACHE] != during.tag_peak[PAL_TAG_CACHE])
+    fail ("cache peak changed from %zu to %zu",
+          during.tag_peak[PAL_TAG_CACHE], after.tag_peak[PAL_TAG_CACHE]);
+  msg ("high-water mark kept");
+
+  palloc_get_stats (PAL_USER, &before);
+  upage = palloc_get_page (PAL_USER);
+  if (upage == NULL)
+    fail ("out of user pages");
+  palloc_get_stats (PAL_USER, &during);
+  palloc_free_page (upage);
+  if (during.tag_cnt[PAL_TAG_USER] != before.tag_cnt[PAL_TAG_USER] + 1)
+    fail ("untagged user page not counted as a user page");
+  msg ("untagged user page counted as a user page");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-account) begin
+(palloc-account) allocated 8 tagged pages
+(palloc-account) freed them
+(palloc-account) high-water mark kept
+(palloc-account) untagged user page counted as a user page
+(palloc-account) end
+EOF
+pass;
@@ -0,0 +1,149 @@
+/* Measures how long the page allocator takes to allocate and free
+   1-page and 8-page blocks from the user pool when the pool is
+   10%, 50% and 95% full.
+
+   Before each measurement the pool is churned by freeing random
+   blocks and allocating blocks of random sizes in their place, so
+   that its free pages are scattered the way they are after a long
+   run instead of forming one big block. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "devices/timer.h"
+
+#define PAIR_CNT 20000
+#define CHURN_CNT 2000
+#define MAX_BLOCK_PAGES 4
+
+/* Blocks held to fill the pool. */
+struct block
+  {
+    void *pages;
+    size_t page_cnt;
+  };
+
+static struct block *blocks;
+static size_t block_cnt;
+
+static void fill (size_t used_cnt);
+static void churn (size_t used_cnt);
+static void measure (int percent, size_t page_cnt);
+static size_t used_pages (void);
+
+void
+test_palloc_bench (void) 
+{
+  static const int percents[] = {10, 50, 95};
+  struct palloc_stats stats;
+  size_t i;
+
+  palloc_get_stats (PAL_USER, &stats);
+  blocks = malloc (stats.page_cnt * sizeof *blocks);
+  if (blocks == NULL)
+    fail ("out of memory for %zu block records", stats.page_cnt);
+  block_cnt = 0;
+
+  for (i = 0; i < sizeof percents / sizeof *percents; i++) 
+    {
+      size_t used_cnt = stats.page_cnt * percents[i] / 100;
+      fill (used_cnt);
+      churn (used_cnt);
+      measure (percents[i], 1);
+      measure (percents[i], 8);
+    }
+
+  while (block_cnt > 0) 
+    {
+      block_cnt--;
+      palloc_free_multiple (blocks[block_cnt].pages,
+                            blocks[block_cnt].page_cnt);
+    }
+  free (blocks);
+
+  palloc_get_stats (PAL_USER, &stats);
+  if (stats.free_cnt != stats.page_cnt)
+    fail ("%zu of %zu pages free after freeing everything",
+          stats.free_cnt, stats.page_cnt);
+  if (stats.largest_free * 2 <= stats.page_cnt)
+    fail ("free pages did not merge back: largest free block is %zu pages",
+          stats.largest_free);
+}
+
+/* Allocates blocks of random sizes until USED_CNT pages of the
+   user pool are in use. */
+static void
+fill (size_t used_cnt) 
+{
+  while (used_pages () < used_cnt) 
+    {
+      size_t page_cnt = random_ulong () % MAX_BLOCK_PAGES + 1;
+      void *pages;
+
+      if (page_cnt > used_cnt - used_pages ())
+        page_cnt = used_cnt - used_pages ();
+      pages = palloc_get_multiple (PAL_USER, page_cnt);
+      if (pages == NULL)
+        fail ("could not fill the user pool to %zu pages", used_cnt);
+      blocks[block_cnt].pages = pages;
+      blocks[block_cnt].page_cnt = page_cnt;
+      block_cnt++;
+    }
+}
+
+/* Replaces random blocks by blocks of random sizes, keeping
+   USED_CNT pages in use. */
+static void
+churn (size_t used_cnt) 
+{
+  int i;
+
+  for (i = 0; i < CHURN_CNT && block_cnt > 0; i++) 
+    {
+      size_t victim = random_ulong () % block_cnt;
+      palloc_free_multiple (blocks[victim].pages, blocks[victim].page_cnt);
+      blocks[victim] = blocks[--block_cnt];
+      fill (used_cnt);
+    }
+}
+
+/* Times PAIR_CNT allocations of PAGE_CNT pages, each freed right
+   away, with the pool PERCENT full. */
+static void
+measure (int percent, size_t page_cnt) 
+{
+  struct palloc_stats stats;
+  int64_t start;
+  int failed = 0;
+  int i;
+
+  start = timer_ticks ();
+  for (i = 0; i < PAIR_CNT; i++) 
+    {
+      void *pages = palloc_get_multiple (PAL_USER, page_cnt);
+      if (pages != NULL)
+        palloc_free_multiple (pages, page_cnt);
+      else
+        failed++;
+    }
+
+  palloc_get_stats (PAL_USER, &stats);
+  msg ("%d%% full, %zu-page blocks: %"PRId64" ticks for %d allocations, "
+       "%d failed, largest free block %zu pages",
+       percent, page_cnt, timer_elapsed (start), PAIR_CNT, failed,
+       stats.largest_free);
+}
+
+/* Returns the number of pages in use in the user pool. */
+static size_t
+used_pages (void) 
+{
+  struct palloc_stats stats;
+
+  palloc_get_stats (PAL_USER, &stats);
+  return stats.page_cnt - stats.free_cnt;
+}
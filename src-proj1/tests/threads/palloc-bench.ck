@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (6, qr/\d+% full, \d+-page blocks: \d+ ticks for \d+ allocations, \d+ failed, largest free block \d+ pages/);
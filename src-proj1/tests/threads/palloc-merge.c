@@ -0,0 +1,97 @@
+/* Checks that the page allocator merges freed blocks back
+   together: the user pool is filled with blocks of random sizes,
+   some of them are freed and reallocated to scatter the free
+   pages, and once everything is freed in random order the pool
+   must have as many free pages, and as large a free block, as
+   it had at the start.  The block may be larger: filling the
+   pool also gives back the pages zeroed while idle. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+
+#define CHURN_CNT 1000
+#define MAX_BLOCK_PAGES 8
+
+/* A block held from the pool. */
+struct block
+  {
+    void *pages;
+    size_t page_cnt;
+  };
+
+static struct block *blocks;
+static size_t block_cnt;
+
+static void fill (void);
+
+void
+test_palloc_merge (void) 
+{
+  struct palloc_stats before, after;
+  size_t i;
+
+  palloc_get_stats (PAL_USER, &before);
+  blocks = malloc (before.page_cnt * sizeof *blocks);
+  if (blocks == NULL)
+    fail ("out of memory for block records");
+  block_cnt = 0;
+
+  random_init (0);
+  fill ();
+  msg ("filled the user pool");
+
+  for (i = 0; i < CHURN_CNT && block_cnt > 0; i++) 
+    {
+      size_t victim = random_ulong () % block_cnt;
+      palloc_free_multiple (blocks[victim].pages, blocks[victim].page_cnt);
+      blocks[victim] = blocks[--block_cnt];
+      fill ();
+    }
+  msg ("freed and reallocated %d blocks", CHURN_CNT);
+
+  while (block_cnt > 0) 
+    {
+      size_t victim = random_ulong () % block_cnt;
+      palloc_free_multiple (blocks[victim].pages, blocks[victim].page_cnt);
+      blocks[victim] = blocks[--block_cnt];
+    }
+  free (blocks);
+  msg ("freed everything");
+
+  palloc_get_stats (PAL_USER, &after);
+  if (after.free_cnt != before.free_cnt)
+    fail ("%zu pages free, expected %zu", after.free_cnt, before.free_cnt);
+  if (after.largest_free < before.largest_free)
+    fail ("largest free block is %zu pages, expected at least %zu",
+          after.largest_free, before.largest_free);
+  msg ("free pages merged back");
+}
+
+/* Allocates blocks of random sizes until one does not fit, then
+   single pages until the pool is full. */
+static void
+fill (void) 
+{
+  size_t page_cnt = random_ulong () % MAX_BLOCK_PAGES + 1;
+
+  for (;;) 
+    {
+      void *pages = palloc_get_multiple (PAL_USER, page_cnt);
+      if (pages == NULL) 
+        {
+          if (page_cnt == 1)
+            break;
+          page_cnt = 1;
+          continue;
+        }
+      blocks[block_cnt].pages = pages;
+      blocks[block_cnt].page_cnt = page_cnt;
+      block_cnt++;
+      if (page_cnt > 1)
+        page_cnt = random_ulong () % MAX_BLOCK_PAGES + 1;
+    }
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-merge) begin
+(palloc-merge) filled the user pool
+(palloc-merge) freed and reallocated 1000 blocks
+(palloc-merge) freed everything
+(palloc-merge) free pages merged back
+(palloc-merge) end
+EOF
+pass;
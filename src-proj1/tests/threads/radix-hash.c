@@ -0,0 +1,150 @@
+/* Checks the radix tree of lib/kernel/radix.c and the
+   open-addressing hash table of lib/kernel/ohash.c against the
+   chained hash table of lib/kernel/hash.c.  The same random mix
+   of insertions and deletions of page numbers goes to all three,
+   enough to make the open-addressing table grow several times,
+   and afterward they must hold the same pages, found by lookup
+   and, in the radix tree, visited in increasing order by
+   radix_next(). */
+
+#include <hash.h>
+#include <ohash.h>
+#include <radix.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+
+/* Page numbers in play, and operations on them. */
+#define KEY_CNT 2048
+#define OP_CNT 20000
+
+/* A page number, as kept in both tables. */
+struct entry
+  {
+    size_t key;                 /* Page number. */
+    bool present;               /* Should be in the tables? */
+    struct hash_elem elem;      /* Element in the hash table. */
+  };
+
+static struct entry entries[KEY_CNT];
+
+static unsigned entry_hash (const struct hash_elem *, void *aux);
+static bool entry_less (const struct hash_elem *, const struct hash_elem *,
+                        void *aux);
+
+void
+test_radix_hash (void) 
+{
+  struct hash h;
+  struct ohash o;
+  struct radix_tree r;
+  size_t present_cnt = 0;
+  size_t key, visited;
+  struct entry *e;
+  int i;
+
+  /* Half the pages in one run low in memory, the others spread
+     out near the top, like code and stack. */
+  for (i = 0; i < KEY_CNT; i++) 
+    {
+      size_t idx = i;
+      entries[i].key = (idx % 2 == 0 ? 0x8048 + idx
+                        : RADIX_KEY_CNT - 1 - idx * 37);
+      entries[i].present = false;
+    }
+
+  if (!hash_init (&h, entry_hash, entry_less, NULL))
+    fail ("out of memory for hash table");
+  ohash_init (&o);
+  radix_init (&r);
+
+  random_init (0);
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      e = &entries[random_ulong () % KEY_CNT];
+      if (random_ulong () % 3 != 0) 
+        {
+          bool hash_new = hash_insert (&h, &e->elem) == NULL;
+          bool ohash_new = ohash_insert (&o, e->key, e);
+          bool radix_new = radix_insert (&r, e->key, e);
+          if (hash_new != !e->present || ohash_new != !e->present
+              || radix_new != !e->present)
+            fail ("inserting page %zu: hash %s, ohash %s, radix %s, "
+                  "expected %s", e->key, hash_new ? "new" : "old",
+                  ohash_new ? "new" : "old", radix_new ? "new" : "old",
+                  e->present ? "old" : "new");
+          if (!e->present)
+            present_cnt++;
+          e->present = true;
+        }
+      else 
+        {
+          bool hash_had = hash_delete (&h, &e->elem) != NULL;
+          void *ohash_had = ohash_delete (&o, e->key);
+          void *radix_had = radix_delete (&r, e->key);
+          if (hash_had != e->present
+              || ohash_had != (e->present ? e : NULL)
+              || radix_had != (e->present ? e : NULL))
+            fail ("deleting page %zu: found by hash %d, by ohash %d, "
+                  "by radix %d, expected %d", e->key, hash_had,
+                  ohash_had != NULL, radix_had != NULL, e->present);
+          if (e->present)
+            present_cnt--;
+          e->present = false;
+        }
+    }
+  if (hash_size (&h) != present_cnt || ohash_size (&o) != present_cnt
+      || radix_size (&r) != present_cnt)
+    fail ("hash holds %zu pages, ohash %zu, radix %zu, expected %zu",
+          hash_size (&h), ohash_size (&o), radix_size (&r), present_cnt);
+  msg ("insertions and deletions agree");
+
+  for (i = 0; i < KEY_CNT; i++) 
+    {
+      bool in_hash = hash_find (&h, &entries[i].elem) != NULL;
+      void *in_ohash = ohash_find (&o, entries[i].key);
+      void *in_radix = radix_lookup (&r, entries[i].key);
+      void *expected = entries[i].present ? &entries[i] : NULL;
+      if (in_hash != entries[i].present || in_ohash != expected
+          || in_radix != expected)
+        fail ("looking up page %zu: found by hash %d, by ohash %d, "
+              "by radix %d, expected %d", entries[i].key, in_hash,
+              in_ohash != NULL, in_radix != NULL, entries[i].present);
+    }
+  msg ("lookups agree");
+
+  key = 0;
+  visited = 0;
+  while ((e = radix_next (&r, &key, RADIX_KEY_CNT - 1)) != NULL) 
+    {
+      if (e->key != key || !e->present)
+        fail ("radix_next returned page %zu at key %zu", e->key, key);
+      visited++;
+      key++;
+    }
+  if (visited != present_cnt)
+    fail ("radix_next visited %zu pages, expected %zu",
+          visited, present_cnt);
+  msg ("radix_next visits every page in order");
+
+  hash_destroy (&h, NULL);
+  ohash_destroy (&o, NULL);
+  radix_destroy (&r, NULL);
+}
+
+static unsigned
+entry_hash (const struct hash_elem *e_, void *aux UNUSED) 
+{
+  const struct entry *e = hash_entry (e_, struct entry, elem);
+  return hash_int (e->key);
+}
+
+static bool
+entry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct entry *a = hash_entry (a_, struct entry, elem);
+  const struct entry *b = hash_entry (b_, struct entry, elem);
+  return a->key < b->key;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(radix-hash) begin
+(radix-hash) insertions and deletions agree
+(radix-hash) lookups agree
+(radix-hash) radix_next visits every page in order
+(radix-hash) end
+EOF
+pass;
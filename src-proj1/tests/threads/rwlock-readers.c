@@ -0,0 +1,61 @@
+/* The main thread holds a readers-writer lock for reading while
+   two higher-priority readers come and go, which they should do
+   without blocking.  Then a writer arrives and must wait for the
+   main thread, and a reader arriving after the writer must wait
+   for the writer, even though the lock is only held for
+   reading at that point. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_readers (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  msg ("main acquired read lock");
+  thread_create ("reader 0", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  thread_create ("reader 2", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  msg ("main releasing read lock");
+  rwlock_release_read (&rw);
+  msg ("Writer, then reader 2 must already have finished.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("%s acquired read lock", thread_name ());
+  rwlock_release_read (rw);
+  msg ("%s done", thread_name ());
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  msg ("writer waiting");
+  rwlock_acquire_write (rw);
+  msg ("writer acquired write lock");
+  rwlock_release_write (rw);
+  msg ("writer done");
+}
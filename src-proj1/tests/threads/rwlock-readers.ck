@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) main acquired read lock
+(rwlock-readers) reader 0 acquired read lock
+(rwlock-readers) reader 0 done
+(rwlock-readers) reader 1 acquired read lock
+(rwlock-readers) reader 1 done
+(rwlock-readers) writer waiting
+(rwlock-readers) main releasing read lock
+(rwlock-readers) writer acquired write lock
+(rwlock-readers) writer done
+(rwlock-readers) reader 2 acquired read lock
+(rwlock-readers) reader 2 done
+(rwlock-readers) Writer, then reader 2 must already have finished.
+(rwlock-readers) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Measures the cost of a context switch as the run queue grows.
+
+   Two threads at the default priority yield to each other while
+   a varying number of lower-priority threads wait in the run
+   queue.  Picking the next thread to run should not depend on
+   how many threads are waiting, so neither should the time the
+   yields take. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define YIELD_CNT 50000
+
+static thread_func spin_thread;
+static void measure (int ready_cnt);
+
+static volatile bool stop;
+static struct semaphore done;
+
+void
+test_sched_switch (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+  measure (0);
+  measure (8);
+  measure (32);
+  measure (128);
+}
+
+/* Times YIELD_CNT yields with READY_CNT threads waiting below. */
+static void
+measure (int ready_cnt) 
+{
+  int64_t start;
+  int i;
+
+  stop = false;
+  for (i = 0; i < ready_cnt; i++)
+    if (thread_create ("waiter", PRI_MIN + 1, spin_thread, NULL) == TID_ERROR)
+      fail ("could not create waiter %d", i);
+  if (thread_create ("partner", PRI_DEFAULT, spin_thread, NULL) == TID_ERROR)
+    fail ("could not create partner");
+
+  start = timer_ticks ();
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  msg ("%d ready threads: %"PRId64" ticks for %d yields",
+       ready_cnt, timer_elapsed (start), YIELD_CNT);
+
+  /* Let the waiters run to completion. */
+  stop = true;
+  for (i = 0; i < ready_cnt + 1; i++)
+    sema_down (&done);
+}
+
+static void
+spin_thread (void *aux UNUSED) 
+{
+  while (!stop)
+    thread_yield ();
+  sema_up (&done);
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (4, qr/\d+ ready threads: \d+ ticks for \d+ yields/);
@@ -0,0 +1,56 @@
+/* Reads a pair of values protected by a sequence lock while a
+   higher-priority thread updates them.  The read that overlaps
+   the update must be retried, and the retried read must see both
+   values updated. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+
+static struct seqlock sl;
+static int64_t first, second;
+
+void
+test_seqlock (void) 
+{
+  int64_t a, b;
+  unsigned seq;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  seqlock_init (&sl);
+  seq = seqlock_read_begin (&sl);
+  a = first;
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, NULL);
+  b = second;
+  msg ("read overlapping the write: %"PRId64" %"PRId64", %s",
+       a, b, seqlock_read_retry (&sl, seq) ? "retry" : "no retry");
+
+  do 
+    {
+      seq = seqlock_read_begin (&sl);
+      a = first;
+      b = second;
+    }
+  while (seqlock_read_retry (&sl, seq));
+  msg ("read after the write: %"PRId64" %"PRId64, a, b);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  seqlock_write_begin (&sl);
+  first++;
+  second++;
+  seqlock_write_end (&sl);
+  msg ("writer: done");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(seqlock) begin
+(seqlock) writer: done
+(seqlock) read overlapping the write: 0 1, retry
+(seqlock) read after the write: 1 1
+(seqlock) end
+EOF
+pass;
@@ -0,0 +1,150 @@
+/* Times memcpy(), memset(), memcmp() and strlen() on blocks of 8
+   bytes to 4 kB against plain byte-at-a-time loops, the way
+   lib/string.c used to do them, and checks that both agree.
+
+   Each measurement moves the same total number of bytes, so the
+   number of calls shrinks as the block size grows. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+/* Bytes processed per measurement. */
+#define TOTAL_BYTES (8 * 1024 * 1024)
+
+/* Largest block size, plus room for misaligning it. */
+#define MAX_SIZE 4096
+#define BUF_SIZE (MAX_SIZE + 8)
+
+static char src[BUF_SIZE], dst[BUF_SIZE];
+
+static void byte_memcpy (void *, const void *, size_t);
+static void byte_memset (void *, int, size_t);
+static int byte_memcmp (const void *, const void *, size_t);
+static size_t byte_strlen (const char *);
+static void measure (const char *name, size_t size, int which);
+
+void
+test_string_bench (void) 
+{
+  static const size_t sizes[] = {8, 16, 64, 256, 512, 1024, 4096};
+  static const char *names[] = {"memcpy", "memset", "memcmp", "strlen"};
+  size_t s;
+  int which;
+
+  for (which = 0; which < 4; which++)
+    for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+      measure (names[which], sizes[s], which);
+}
+
+/* Times the byte loop and the library version of function WHICH,
+   in the order of the names in test_string_bench(), on blocks of
+   SIZE bytes that start one byte past a word boundary. */
+static void
+measure (const char *name, size_t size, int which) 
+{
+  int call_cnt = TOTAL_BYTES / size;
+  int64_t byte_ticks = 0, word_ticks = 0, start;
+  int pass;
+  size_t i;
+
+  for (i = 0; i < sizeof src; i++)
+    src[i] = 'a' + i % 26;
+  src[1 + size] = '\0';
+  if (which == 0)
+    memset (dst, 0, sizeof dst);
+  else
+    memcpy (dst, src, sizeof dst);
+
+  for (pass = 0; pass < 2; pass++) 
+    {
+      int call;
+
+      start = timer_ticks ();
+      for (call = 0; call < call_cnt; call++) 
+        switch (which) 
+          {
+          case 0:
+            if (pass == 0)
+              byte_memcpy (dst + 1, src + 1, size);
+            else
+              memcpy (dst + 1, src + 1, size);
+            break;
+          case 1:
+            if (pass == 0)
+              byte_memset (dst + 1, call, size);
+            else
+              memset (dst + 1, call, size);
+            break;
+          case 2:
+            if ((pass == 0 ? byte_memcmp (dst + 1, src + 1, size)
+                 : memcmp (dst + 1, src + 1, size)) != 0)
+              fail ("%s: %zu-byte blocks differ", name, size);
+            break;
+          case 3:
+            if ((pass == 0 ? byte_strlen (src + 1)
+                 : strlen (src + 1)) != size)
+              fail ("%s: wrong length for %zu-byte string", name, size);
+            break;
+          }
+      if (pass == 0)
+        byte_ticks = timer_elapsed (start);
+      else
+        word_ticks = timer_elapsed (start);
+
+      /* Both versions must leave the same bytes behind. */
+      if (which == 0 && (memcmp (dst + 1, src + 1, size) != 0
+                         || dst[0] != 0 || dst[size + 1] != 0))
+        fail ("%s: %zu-byte copy is wrong", name, size);
+      if (which == 1 && (dst[0] != src[0] || dst[size + 1] != src[size + 1]
+                         || dst[size] != (char) (call_cnt - 1)))
+        fail ("%s: %zu-byte fill is wrong", name, size);
+    }
+
+  msg ("%s, %zu bytes: %"PRId64" ticks byte by byte, "
+       "%"PRId64" ticks by words", name, size, byte_ticks, word_ticks);
+}
+
+static void
+byte_memcpy (void *dst_, const void *src_, size_t size) 
+{
+  char *dst = dst_;
+  const char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+static void
+byte_memset (void *dst_, int value, size_t size) 
+{
+  char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size) 
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_strlen (const char *string) 
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::bench;
+check_bench (28, qr/(memcpy|memset|memcmp|strlen), \d+ bytes: \d+ ticks byte by byte, \d+ ticks by words/);
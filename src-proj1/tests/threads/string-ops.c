@@ -0,0 +1,118 @@
+/* Checks the results of memcpy(), memset(), memcmp() and
+   strlen(), which work a word at a time where they can, for
+   every size up to 80 bytes and a few larger ones, at every alignment of source and destination
+   within a word.  The bytes just around each destination must
+   stay untouched. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+
+/* Largest size checked, plus room for misaligning it and for
+   guard bytes on both sides. */
+#define MAX_SIZE 4096
+#define BUF_SIZE (MAX_SIZE + 16)
+
+/* Value of the bytes around a destination. */
+#define GUARD 0x5a
+
+static char src[BUF_SIZE], dst[BUF_SIZE];
+
+static void check_size (size_t size);
+static void check_guards (const char *name, size_t ofs, size_t size);
+
+void
+test_string_ops (void) 
+{
+  static const size_t big_sizes[] = {127, 128, 255, 1000, 4095, 4096};
+  size_t size, i;
+
+  for (size = 0; size <= 80; size++)
+    check_size (size);
+  for (i = 0; i < sizeof big_sizes / sizeof *big_sizes; i++)
+    check_size (big_sizes[i]);
+  msg ("memcpy, memset, memcmp and strlen results correct");
+}
+
+/* Checks all four functions on SIZE-byte blocks at each pair of
+   source and destination offsets. */
+static void
+check_size (size_t size) 
+{
+  size_t src_ofs, dst_ofs, i;
+
+  for (src_ofs = 1; src_ofs <= 4; src_ofs++)
+    for (dst_ofs = 1; dst_ofs <= 4; dst_ofs++) 
+      {
+        const char *s = src + src_ofs;
+        char *d = dst + dst_ofs;
+        int cmp;
+
+        for (i = 0; i < sizeof src; i++)
+          src[i] = 'a' + i % 26;
+
+        /* memcpy(). */
+        memset (dst, GUARD, sizeof dst);
+        if (memcpy (d, s, size) != d)
+          fail ("memcpy: wrong return value");
+        for (i = 0; i < size; i++)
+          if (d[i] != s[i])
+            fail ("memcpy: %zu bytes at offsets %zu and %zu: byte %zu wrong",
+                  size, src_ofs, dst_ofs, i);
+        check_guards ("memcpy", dst_ofs, size);
+
+        /* memset(). */
+        memset (dst, GUARD, sizeof dst);
+        if (memset (d, 0x100 + src_ofs, size) != d)
+          fail ("memset: wrong return value");
+        for (i = 0; i < size; i++)
+          if (d[i] != (char) src_ofs)
+            fail ("memset: %zu bytes at offset %zu: byte %zu wrong",
+                  size, dst_ofs, i);
+        check_guards ("memset", dst_ofs, size);
+
+        /* memcmp(), equal and differing at the first, a middle,
+           and the last byte. */
+        memcpy (d, s, size);
+        if (memcmp (d, s, size) != 0)
+          fail ("memcmp: %zu equal bytes at offsets %zu and %zu differ",
+                size, src_ofs, dst_ofs);
+        for (i = 0; size > 0 && i < 3; i++) 
+          {
+            size_t pos = i == 0 ? 0 : i == 1 ? size / 2 : size - 1;
+
+            d[pos] = s[pos] + 1;
+            cmp = memcmp (d, s, size);
+            if (cmp <= 0)
+              fail ("memcmp: %zu bytes at offsets %zu and %zu, larger byte "
+                    "%zu: returned %d", size, src_ofs, dst_ofs, pos, cmp);
+            d[pos] = (char) 0x80;
+            cmp = memcmp (s, d, size);
+            if (cmp >= 0)
+              fail ("memcmp: %zu bytes at offsets %zu and %zu, byte %zu "
+                    "of 0x80: returned %d",
+                    size, src_ofs, dst_ofs, pos, cmp);
+            d[pos] = s[pos];
+          }
+
+        /* strlen(). */
+        src[src_ofs + size] = '\0';
+        if (strlen (s) != size)
+          fail ("strlen: %zu-byte string at offset %zu: got %zu",
+                size, src_ofs, strlen (s));
+      }
+}
+
+/* Checks that the bytes of DST just around the SIZE bytes at OFS
+   still hold GUARD after NAME wrote those SIZE bytes. */
+static void
+check_guards (const char *name, size_t ofs, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < ofs + size + 8; i++)
+    if ((i < ofs || i >= ofs + size) && dst[i] != (char) GUARD)
+      fail ("%s: %zu bytes at offset %zu: byte %zu outside changed",
+            name, size, ofs, i);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(string-ops) begin
+(string-ops) memcpy, memset, memcmp and strlen results correct
+(string-ops) end
+EOF
+pass;
@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-many", test_alarm_many},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -38,6 +39,18 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"sched-switch", test_sched_switch},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-donate", test_rwlock_donate},
+    {"seqlock", test_seqlock},
+    {"palloc-bench", test_palloc_bench},
+    {"malloc-bench", test_malloc_bench},
+    {"string-bench", test_string_bench},
+    {"hash-bench", test_hash_bench},
+    {"palloc-account", test_palloc_account},
+    {"palloc-merge", test_palloc_merge},
+    {"string-ops", test_string_ops},
+    {"radix-hash", test_radix_hash},
   };
 
 static const char *test_name;
@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_many;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -32,6 +33,18 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_sched_switch;
+extern test_func test_rwlock_readers;
+extern test_func test_rwlock_donate;
+extern test_func test_seqlock;
+extern test_func test_palloc_bench;
+extern test_func test_malloc_bench;
+extern test_func test_string_bench;
+extern test_func test_hash_bench;
+extern test_func test_palloc_account;
+extern test_func test_palloc_merge;
+extern test_func test_string_ops;
+extern test_func test_radix_hash;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
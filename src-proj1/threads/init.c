@@ -161,7 +161,8 @@ paging_init (void)
   size_t page;
   extern char _start, _end_kernel_text;
 
-  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                        | PAL_TAG (PAL_TAG_PAGEDIR));
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
     {
@@ -173,7 +174,8 @@ paging_init (void)
 
       if (pd[pde_idx] == 0)
         {
-          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                | PAL_TAG (PAL_TAG_PAGEDIR));
           pd[pde_idx] = pde_create (pt);
         }
 
@@ -0,0 +1,253 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator.
+
+   Each slab is one page.  It starts with a struct slab header,
+   followed by the cache's objects, STRIDE bytes apart.  The free
+   objects of a slab form a singly linked list threaded through
+   the objects themselves, with the link at LINK_OFS.  Without a
+   constructor the link overlays the start of the object; with
+   one, it sits past the object's end so that it does not disturb
+   the constructed state.
+
+   A cache keeps its partially used slabs on a list, allocates
+   from the front one, and forgets a slab while it is full;
+   slab_free() finds an object's slab by rounding its address down
+   to a page boundary.  When a slab becomes entirely free, the cache keeps it
+   as its spare if it has none, and otherwise gives the page back
+   to the page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free;                 /* First free object. */
+    struct list_elem elem;      /* Element in cache's partial list. */
+  };
+
+/* All caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *new_slab (struct slab_cache *);
+static struct slab *object_to_slab (struct slab_cache *, void *);
+
+/* Returns the free list link in OBJECT of cache C. */
+static inline void **
+object_link (const struct slab_cache *c, void *object) 
+{
+  return (void **) ((uint8_t *) object + c->link_ofs);
+}
+
+/* Initializes C as a cache named NAME of SIZE-byte objects, each
+   aligned on an ALIGN-byte boundary, which must be a power of 2,
+   or on a pointer boundary if ALIGN is 0.  CTOR, if nonnull,
+   constructs each object when its slab is created. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t size,
+                 size_t align, slab_ctor_func *ctor) 
+{
+  enum intr_level old_level;
+
+  if (align < sizeof (void *))
+    align = sizeof (void *);
+  ASSERT ((align & (align - 1)) == 0);
+  ASSERT (size > 0);
+
+  c->name = name;
+  c->obj_size = size;
+  c->ctor = ctor;
+  c->link_ofs = ctor != NULL ? ROUND_UP (size, sizeof (void *)) : 0;
+  c->stride = ROUND_UP (size > c->link_ofs + sizeof (void *)
+                        ? size : c->link_ofs + sizeof (void *), align);
+  c->first_ofs = ROUND_UP (sizeof (struct slab), align);
+  if (c->first_ofs + c->stride > PGSIZE)
+    PANIC ("%s: %zu-byte objects do not fit in a slab", name, size);
+  c->obj_cnt = (PGSIZE - c->first_ofs) / c->stride;
+
+  lock_init (&c->lock);
+  list_init (&c->partial);
+  c->spare = NULL;
+
+  c->slab_cnt = 0;
+  c->in_use = 0;
+  c->peak_in_use = 0;
+  c->alloc_cnt = 0;
+  c->fail_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &c->elem);
+  intr_set_level (old_level);
+}
+
+/* Obtains and returns a new object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c) 
+{
+  struct slab *s;
+  void *object;
+
+  lock_acquire (&c->lock);
+
+  /* Find a slab with a free object, making one if needed. */
+  if (list_empty (&c->partial)) 
+    {
+      if (c->spare != NULL) 
+        {
+          s = c->spare;
+          c->spare = NULL;
+        }
+      else 
+        {
+          s = new_slab (c);
+          if (s == NULL) 
+            {
+              c->fail_cnt++;
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+
+  /* Take its first free object, dropping the slab from the
+     partial list if it is now full. */
+  object = s->free;
+  s->free = *object_link (c, object);
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+
+  c->alloc_cnt++;
+  if (++c->in_use > c->peak_in_use)
+    c->peak_in_use = c->in_use;
+
+  lock_release (&c->lock);
+  return object;
+}
+
+/* Returns OBJECT, which must have been allocated from cache C
+   with slab_alloc(), to C.  A null OBJECT is ignored. */
+void
+slab_free (struct slab_cache *c, void *object) 
+{
+  struct slab *s;
+
+  if (object == NULL)
+    return;
+  s = object_to_slab (c, object);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to stay constructed. */
+  if (c->ctor == NULL)
+    memset (object, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+
+  /* A full slab is not on the partial list; put it back. */
+  if (s->free_cnt == 0)
+    list_push_front (&c->partial, &s->elem);
+  *object_link (c, object) = s->free;
+  s->free = object;
+  c->in_use--;
+
+  /* If the slab is now entirely free, keep it or free it. */
+  if (++s->free_cnt == c->obj_cnt) 
+    {
+      list_remove (&s->elem);
+      if (c->spare == NULL)
+        c->spare = s;
+      else 
+        {
+          s->magic = 0;
+          palloc_free_page (s);
+          c->slab_cnt--;
+        }
+    }
+
+  lock_release (&c->lock);
+}
+
+/* Prints the statistics of every cache. */
+void
+slab_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e)) 
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      printf ("Slab: %s: %zu-byte objects, %zu in use (peak %zu), "
+              "%zu slabs, %"PRIu64" allocs, %"PRIu64" failed\n",
+              c->name, c->obj_size, c->in_use, c->peak_in_use,
+              c->slab_cnt, c->alloc_cnt, c->fail_cnt);
+    }
+}
+
+/* Allocates a slab for cache C and carves it into free objects,
+   constructing them if C has a constructor.  Returns a null
+   pointer if no page is available.  C's lock must be held. */
+static struct slab *
+new_slab (struct slab_cache *c) 
+{
+  struct slab *s;
+  uint8_t *object;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  s = palloc_get_page (PAL_TAG (PAL_TAG_SLAB));
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->obj_cnt;
+  s->free = NULL;
+
+  /* Link the objects in address order. */
+  object = (uint8_t *) s + c->first_ofs + (c->obj_cnt - 1) * c->stride;
+  for (i = 0; i < c->obj_cnt; i++, object -= c->stride) 
+    {
+      if (c->ctor != NULL)
+        c->ctor (object);
+      *object_link (c, object) = s->free;
+      s->free = object;
+    }
+
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab that OBJECT of cache C is inside. */
+static struct slab *
+object_to_slab (struct slab_cache *c, void *object) 
+{
+  struct slab *s = pg_round_down (object);
+
+  /* Check that the slab is valid. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (object) >= c->first_ofs);
+  ASSERT ((pg_ofs (object) - c->first_ofs) % c->stride == 0);
+
+  return s;
+}
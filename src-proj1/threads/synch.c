@@ -32,6 +32,8 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+static void catch_up_waiters (struct list *waiters);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -108,20 +110,26 @@ sema_try_down (struct semaphore *sema)
 
   ************* Our implementation *************
   Select the thread which has the maximum priority among
-  all waiters and unblock it.
+  all waiters and unblock it.  Yield only if it outranks the
+  running thread, so an uncontended up costs no switch.
 */
 void
 sema_up (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  struct thread *max_t = NULL;
 
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)){     
+    /* Waiters missed the recent_cpu decays while blocked */
+    if (thread_mlfqs)
+      catch_up_waiters (&sema->waiters);
+
     /* Get the thread that has the highest priority */
     struct list_elem *max_elem = list_max(&(sema->waiters), less_func, NULL);
-    struct thread *max_t = list_entry (max_elem, struct thread, elem);
+    max_t = list_entry (max_elem, struct thread, elem);
 
     /* Remove the max_elem from waiter_list */
     list_remove(max_elem);
@@ -130,10 +138,15 @@ sema_up (struct semaphore *sema)
     thread_unblock(max_t);  
   }
   sema->value++;
-  intr_set_level (old_level);
 
-  /* Let the main thread relinquish the CPU */
-  thread_yield();           
+  /* Let the running thread relinquish the CPU to a higher one */
+  if (max_t != NULL && max_t->priority > thread_get_priority ()){
+    if (intr_context ())
+      intr_yield_on_return ();
+    else
+      thread_yield ();
+  }
+  intr_set_level (old_level);
 }
 
 static void sema_test_helper (void *sema_);
@@ -220,15 +233,12 @@ lock_acquire (struct lock *lock)
   enum intr_level old_level = intr_disable ();          /* Disable interrupts */
   int depth = 0;
   if(!thread_mlfqs){                                    /* No priority donation in mlfqs mode */
-    if(lock->holder == NULL){                           /* If the lock has no holder */
-      list_push_back(&(thread_current()->lock_list), &(lock->elem));
-    }
-    else{                                               /* If the lock has no holder */
+    if(lock->holder != NULL){                           /* If the lock has a holder */
       int curr_priority = thread_current() -> priority; /* Get priority of current thread */
       struct lock *lock_iter;                           /* Initialize a lock iterator */
 
       if(lock->holder->priority < curr_priority){       /* If thread's priority higher */
-        lock->holder->priority = curr_priority;         /* donate to lock's holder */
+        thread_change_priority(lock->holder, curr_priority);  /* donate to lock's holder */
         lock->priority_representation = curr_priority;  /* Update the priority representation */
       }
 
@@ -236,7 +246,7 @@ lock_acquire (struct lock *lock)
       for(lock_iter = lock->holder->lock_waiting;       /* Traverse waiting locks */
           lock_iter != NULL && depth <= 7; lock_iter = lock_iter->holder->lock_waiting){
         if(curr->priority > lock_iter->holder->priority){
-          lock_iter->holder->priority = curr->priority; /* Donation the priority in a chain */
+          thread_change_priority(lock_iter->holder, curr->priority);  /* Donation the priority in a chain */
           lock_iter->priority_representation = curr->priority;  /* Also update the representation */
         } 
         curr = lock_iter->holder;
@@ -248,6 +258,8 @@ lock_acquire (struct lock *lock)
     /* Try to block it self to wait or hold the lock */
     sema_down (&lock->semaphore);                       
     lock->holder = thread_current ();
+    thread_current ()->lock_waiting = NULL;             /* Not waiting any more */
+    list_push_back(&(thread_current()->lock_list), &(lock->elem));
   }
   else{
     sema_down (&lock->semaphore);
@@ -265,14 +277,20 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
-  if (success)
+  if (success){
     lock->holder = thread_current ();
+    if (!thread_mlfqs)                  /* lock_release() takes it off again */
+      list_push_back (&thread_current ()->lock_list, &lock->elem);
+  }
+  intr_set_level (old_level);
   return success;
 }
 
@@ -290,7 +308,7 @@ lock_release (struct lock *lock)
   if(!thread_mlfqs){
     list_remove(&(lock->elem));                         /* Remove this lock from the thread */
     if(list_empty(&(thread_current()->lock_list))){     /* No lock any more */
-      thread_current()->priority = thread_current()->ori_priority;  /* Priority change to ori */
+      thread_change_priority(thread_current(), thread_current()->ori_priority);  /* Priority change to ori */
     }
     else{
       /* Initialize a recorder to record the max_priority in lock list */
@@ -308,10 +326,10 @@ lock_release (struct lock *lock)
       /* If all those remaining locks has no waiter threads, max_remain will be -1,
           and reset priority to original. Otherwise, update to max_remain */
       if(max_remain == -1){
-        thread_current()->priority = thread_current()->ori_priority;
+        thread_change_priority(thread_current(), thread_current()->ori_priority);
       }
       else{
-        thread_current()->priority = max_remain;
+        thread_change_priority(thread_current(), max_remain);
       }
     }
   }
@@ -428,6 +446,15 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)){
+    /* Waiters missed the recent_cpu decays while blocked */
+    if (thread_mlfqs){
+      enum intr_level old_level = intr_disable ();
+      for (struct list_elem *e = list_begin (&cond->waiters); e != list_end (&cond->waiters);
+           e = list_next (e))
+        catch_up_waiters (&list_entry (e, struct semaphore_elem, elem)->semaphore.waiters);
+      intr_set_level (old_level);
+    }
+
     /* Select the semaphore whose waiters are highest-priority */
     struct list_elem *max_elem = list_max(&(cond->waiters), sema_less_func, NULL);
     struct semaphore_elem *max_se = list_entry (max_elem, struct semaphore_elem, elem);
@@ -454,4 +481,205 @@ cond_broadcast (struct condition *cond, struct lock *lock)
 
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
-}
\ No newline at end of file
+}
+
+/* Initializes readers-writer lock RW.  Any number of readers may
+   hold RW at once, or else a single writer.
+
+   RW prefers writers: once a writer holds or waits for RW, new
+   readers queue up behind it on WRITE_LOCK, so a steady stream of
+   readers cannot starve writers.  Queueing there also donates the
+   readers' priority to the writer holding RW. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->write_lock);
+  sema_init (&rw->drained, 0);
+  rw->readers = 0;
+  rw->writers = 0;
+  rw->draining = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (rw->writers > 0) 
+    {
+      /* Wait our turn behind the writers. */
+      lock_acquire (&rw->write_lock);
+      rw->readers++;
+      lock_release (&rw->write_lock);
+    }
+  else
+    rw->readers++;
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out lets a waiting writer in. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->draining) 
+    {
+      rw->draining = false;
+      sema_up (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until the writers before us
+   are done and every reader has left.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writers++;
+  lock_acquire (&rw->write_lock);
+  while (rw->readers > 0) 
+    {
+      rw->draining = true;
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writers--;
+  lock_release (&rw->write_lock);
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->write_lock);
+}
+
+/* Initializes sequence lock SL.  A sequence lock protects a small
+   value that is read far more often than written, such as a
+   64-bit counter.  Readers take no lock at all: they note the
+   sequence number, copy the value, and start over if a write
+   happened meanwhile.  Writers run with interrupts off, so they
+   exclude each other and must not sleep.
+
+   A reader looks like this:
+
+     do 
+       {
+         seq = seqlock_read_begin (&sl);
+         copy = value;
+       }
+     while (seqlock_read_retry (&sl, seq)); */
+void
+seqlock_init (struct seqlock *sl) 
+{
+  ASSERT (sl != NULL);
+
+  sl->seq = 0;
+}
+
+/* Begins a read of the value protected by SL and returns the
+   sequence number to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *sl) 
+{
+  unsigned seq;
+
+  for (;;) 
+    {
+      seq = sl->seq;
+      barrier ();
+      if ((seq & 1) == 0)
+        return seq;
+
+      /* A writer on another processor is in the middle. */
+      asm volatile ("pause");
+    }
+}
+
+/* Returns true if the value protected by SL may have changed
+   since seqlock_read_begin() returned SEQ, in which case the
+   reader must start over. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned seq) 
+{
+  barrier ();
+  return sl->seq != seq;
+}
+
+/* Begins a write of the value protected by SL.  Interrupts stay
+   off until the matching seqlock_write_end(). */
+void
+seqlock_write_begin (struct seqlock *sl) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  sl->seq++;
+  barrier ();
+  sl->old_level = old_level;
+}
+
+/* Ends a write of the value protected by SL. */
+void
+seqlock_write_end (struct seqlock *sl) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (sl->seq & 1);
+
+  barrier ();
+  sl->seq++;
+  intr_set_level (sl->old_level);
+}
+/* Bring the recent_cpu and priority of every thread in WAITERS up
+   to date before one of them is picked (mlfqs).
+   Must be called with interrupts off. */
+static void
+catch_up_waiters (struct list *waiters)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (waiters); e != list_end (waiters); e = list_next (e))
+    catch_up_recent_cpu (list_entry (e, struct thread, elem));
+}
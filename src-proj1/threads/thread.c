@@ -12,6 +12,7 @@
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/fixed_point.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -21,9 +22,17 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of priority levels. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Run queue: processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running, kept in one
+   FIFO list per priority.  Bit P of ready_bitmap is set if and
+   only if ready_queues[P] is not empty, so the highest nonempty
+   level is found in constant time. */
+static struct list ready_queues[PRI_CNT];
+static uint32_t ready_bitmap[PRI_CNT / 32];
+static size_t ready_cnt;        /* # of threads in the run queue. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -41,6 +50,15 @@ static struct lock tid_lock;
 /* System load average, initialize it to 0 */
 static int64_t load_avg = I2FP(0);
 
+/* Decay of recent_cpu.  Once a second every thread's recent_cpu
+   decays by a factor that depends on load_avg at that moment.
+   Only the running and ready threads are decayed right away; a
+   blocked thread remembers the second it was last decayed at and
+   catches up on the factors it missed when it is needed again. */
+#define DECAY_HISTORY 256                       /* Seconds of factors kept, a power of 2 */
+static int64_t decay_factor[DECAY_HISTORY];     /* Factor applied at each second, by epoch */
+static int64_t decay_epoch;                     /* Seconds decayed since boot */
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -68,6 +86,8 @@ static void kernel_thread (thread_func *, void *aux);
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
@@ -91,10 +111,13 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -182,7 +205,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = palloc_get_page (PAL_ZERO | PAL_TAG (PAL_TAG_THREAD));
   if (t == NULL)
     return TID_ERROR;
 
@@ -208,6 +231,7 @@ thread_create (const char *name, int priority,
   /* Inherite niceness and recent_cpu from parent thread*/
   t->niceness = thread_current()->niceness;
   t->recent_cpu = thread_current()->recent_cpu;
+  t->decay_epoch = thread_current()->decay_epoch;
 
   /* Add to run queue. */
   thread_unblock (t);
@@ -250,7 +274,15 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+
+  /* An interrupt ends an idle period: catch up on the ticks that
+     timer_idle() let pass before T gets to run. */
+  if (intr_context () && thread_current () == idle_thread)
+    timer_resume ();
+
+  if (thread_mlfqs)
+    catch_up_recent_cpu (t);
+  ready_push (t);
   t->status = THREAD_READY;
   intr_set_level (old_level);
 }
@@ -321,7 +353,7 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -357,11 +389,11 @@ thread_set_priority (int new_priority)
   enum intr_level old_level = intr_disable ();    /* Disable interrupts */
   thread_current()->ori_priority = new_priority;  /* Update thread's original priority */
   if(list_empty(&(thread_current()->lock_list))){ /* If the thread has no lock */ 
-      thread_current()->priority = new_priority;  /* Update priority to new priority */
+      thread_change_priority(thread_current(), new_priority);  /* Update priority to new priority */
   }
   else{                                           /* If thread has other locks */
     if(new_priority > thread_current()->priority){
-      thread_current()->priority = new_priority;  /* update priority if new_priority is higher */
+      thread_change_priority(thread_current(), new_priority);  /* update priority if new_priority is higher */
     }
   }
   intr_set_level(old_level);                      /* Renable interrupts */
@@ -386,8 +418,10 @@ thread_get_priority (void)
 void
 thread_set_nice (int nice UNUSED) 
 {
+  enum intr_level old_level = intr_disable ();    /* Disable interrupts */
   thread_current()->niceness = nice;
   update_priority(thread_current(), NULL);
+  intr_set_level(old_level);                      /* Renable interrupts */
   thread_yield();
 }
 
@@ -412,22 +446,68 @@ thread_get_recent_cpu (void)
   return FP2IN(MULFI(thread_current()->recent_cpu,100));
 }
 
-/* Function that update recent_cpu */
+/* Function that decays recent_cpu once a second.
+   Records this second's decay factor, then brings the threads that
+   compete for the CPU up to date.  Blocked threads are left alone,
+   their priority does not matter until they wake up.
+   This function must be called with interrupts off. */
 void
-update_recent_cpu_all(struct thread *t, void* aux UNUSED)
+update_recent_cpu(void)
 {
-  if(t != idle_thread){
-    t->recent_cpu = MULFF(DIVFF(MULFI(load_avg,2),ADDFI(MULFI(load_avg,2),1)),t->recent_cpu);
-    t->recent_cpu = ADDFI(t->recent_cpu,t->niceness);
-    update_priority(t, NULL);
+  int64_t twice_load = MULFI(load_avg,2);
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  decay_epoch ++;
+  decay_factor[decay_epoch & (DECAY_HISTORY - 1)] = DIVFF(twice_load,ADDFI(twice_load,1));
+
+  catch_up_recent_cpu(thread_current());
+  for(int level = PRI_CNT - 1; level >= 0; level --){
+    struct list_elem *e = list_begin(&ready_queues[level]);
+    while(e != list_end(&ready_queues[level])){
+      struct thread *t = list_entry(e, struct thread, elem);
+      e = list_next(e);                 /* T may move to a lower queue */
+      catch_up_recent_cpu(t);
+    }
   }
 }
-
+
+/* Function that applies the decays thread T missed since it was
+   last decayed, then updates its priority.  Seconds that fell out
+   of the history decay by the oldest factor kept, at most
+   DECAY_HISTORY times; by then the old recent_cpu has vanished at
+   any realistic load.
+   This function must be called with interrupts off. */
+void
+catch_up_recent_cpu(struct thread *t)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  if(t == idle_thread || t->decay_epoch == decay_epoch){
+    return;
+  }
+
+  int64_t first = t->decay_epoch + 1;
+  int64_t oldest = decay_epoch - DECAY_HISTORY + 1;
+  if(first < oldest){
+    int64_t factor = decay_factor[oldest & (DECAY_HISTORY - 1)];
+    int64_t missed = oldest - first < DECAY_HISTORY ? oldest - first : DECAY_HISTORY;
+    while(missed-- > 0){
+      t->recent_cpu = ADDFI(MULFF(factor,t->recent_cpu),t->niceness);
+    }
+    first = oldest;
+  }
+  for(int64_t epoch = first; epoch <= decay_epoch; epoch ++){
+    int64_t factor = decay_factor[epoch & (DECAY_HISTORY - 1)];
+    t->recent_cpu = ADDFI(MULFF(factor,t->recent_cpu),t->niceness);
+  }
+  t->decay_epoch = decay_epoch;
+  update_priority(t, NULL);
+}
+
 /* Function that update load_avg */
 void
 update_load_avg(void)
 {
-  size_t count = list_size(&ready_list);
+  size_t count = ready_cnt;
   if(thread_current() != idle_thread){
     count ++;
   }
@@ -438,15 +518,38 @@ update_load_avg(void)
 void
 update_priority(struct thread *t, void* aux UNUSED){
   if(t != idle_thread){
-    t->priority = FP2IN(SUBFF(I2FP(PRI_MAX),ADDFI(DIVFI(t->recent_cpu,4),2*t->niceness)));
-    if(t->priority < PRI_MIN){
-      t->priority = PRI_MIN;
-      return;
+    int priority = FP2IN(SUBFF(I2FP(PRI_MAX),ADDFI(DIVFI(t->recent_cpu,4),2*t->niceness)));
+    if(priority < PRI_MIN){
+      priority = PRI_MIN;
     }
-    if(t->priority > PRI_MAX){
-      t->priority = PRI_MAX;
-      return;
+    if(priority > PRI_MAX){
+      priority = PRI_MAX;
     }
+    thread_change_priority(t, priority);    /* Requeue t if it is ready */
+  }
+}
+
+/* Set the priority of thread T to PRIORITY, moving T to the
+   matching run queue if it is ready.  Every change of a thread's
+   effective priority must go through here.
+   This function must be called with interrupts off. */
+void
+thread_change_priority(struct thread *t, int priority)
+{
+  ASSERT(is_thread(t));
+  ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if(t->priority == priority){
+    return;
+  }
+  if(t->status == THREAD_READY){    /* Ready threads are queued by priority */
+    ready_remove(t);
+    t->priority = priority;
+    ready_push(t);
+  }
+  else{
+    t->priority = priority;
   }
 }
 
@@ -477,10 +580,19 @@ idle (void *idle_started_ UNUSED)
 
   for (;;) 
     {
+      /* Zero free pages for PAL_ZERO requests until there is
+         nothing left to zero or another thread becomes ready. */
+      while (ready_cnt == 0 && palloc_zero_idle ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
 
+      /* Nothing is ready: stop the periodic tick until something
+         is due. */
+      timer_idle ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -548,14 +660,14 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->ori_priority = priority;
 
-  t->block_start = 0;
-  t->block_time = INT64_MAX;
+  t->wakeup_tick = 0;
 
   t->lock_waiting = NULL;
   list_init(&(t->lock_list));
 
   t->niceness = 0;
   t->recent_cpu = I2FP(0);
+  t->decay_epoch = decay_epoch;
 
   t->magic = THREAD_MAGIC;
 
@@ -600,18 +712,49 @@ less_func(struct list_elem *e1, struct list_elem *e2, void* aux UNUSED)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list)){
+  if (ready_cnt == 0){
     return idle_thread;
   }
   else{
-    /* Get the max list_elem of ready-list */
-    struct list_elem *max_elem = list_max(&ready_list, less_func, NULL);
-    struct thread *t = list_entry (max_elem, struct thread, elem); /* restore it to thread */
-    list_remove(max_elem);  /* Remove this thread from list */
+    /* Find the highest nonempty level with bsr, no scan */
+    int word = ready_bitmap[1] != 0 ? 1 : 0;
+    uint32_t bits = ready_bitmap[word];
+    uint32_t bit;
+    asm ("bsrl %1, %0" : "=r" (bit) : "rm" (bits));
+
+    /* Take the thread that has waited longest at that level */
+    struct list *queue = &ready_queues[word * 32 + bit];
+    struct thread *t = list_entry (list_front (queue), struct thread, elem);
+    ready_remove (t);
     return t;
   }
 }
 
+/* Append T to the run queue of its priority */
+static void
+ready_push (struct thread *t) 
+{
+  int level = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  list_push_back (&ready_queues[level], &t->elem);
+  ready_bitmap[level / 32] |= 1u << (level % 32);
+  ready_cnt++;
+}
+
+/* Remove T from the run queue of its priority */
+static void
+ready_remove (struct thread *t) 
+{
+  int level = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[level]))
+    ready_bitmap[level / 32] &= ~(1u << (level % 32));
+  ready_cnt--;
+}
+
 /* Completes a thread switch by activating the new thread's page
    tables, and, if the previous thread is dying, destroying it.
 
@@ -97,11 +97,11 @@ struct thread
     struct list lock_list;              /* Locks hold by the thread (Part2) */
     struct lock* lock_waiting;          /* The lock the thread is waiting (Part2) */
 
-    int64_t block_start;                /* Record the time the thread start to be blocked (Part1) */
-    int64_t block_time;                 /* Record the time the thread should be blocked (Part1) */
+    int64_t wakeup_tick;                /* Record the tick a sleeping thread wakes up at (Part1) */
 
     int niceness;                       /* Nice value of the thread: [-20, 20] (Part3) */
     int64_t recent_cpu;                 /* Recent CPU of the thread (Part3) */
+    int64_t decay_epoch;                /* Second recent_cpu was last decayed at (Part3) */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -155,9 +155,11 @@ int thread_get_load_avg (void);
 int less_func(struct list_elem *e1, struct list_elem *e2, void* aux UNUSED);
 
 /* Some updating functions required in mlfqs mode */
-void update_recent_cpu_all(struct thread *t, void* aux UNUSED);
+void update_recent_cpu(void);
+void catch_up_recent_cpu(struct thread *t);
 void update_load_avg(void);
 void update_priority(struct thread *t, void* aux UNUSED);
+void thread_change_priority(struct thread *t, int priority);
 void increament_current_thread_recent_cpu(void);
 
 #endif /* threads/thread.h */
@@ -7,6 +7,8 @@
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+bool input_getc_unless (bool (*stop) (void), uint8_t *key);
+void input_kick (void);
 bool input_full (void);
 
 #endif /* devices/input.h */
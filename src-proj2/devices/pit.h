@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_configure_count (int channel, int mode, uint16_t count);
+uint16_t pit_read_count (int channel);
 
 #endif /* devices/pit.h */
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -17,14 +18,44 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  64 bits take two
+   loads to read, so readers go through TICKS_SEQ instead of
+   turning interrupts off. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Threads blocked in timer_sleep(), in order of wakeup tick.
+   A sleeping thread is on no other list, so its `elem' links it
+   in here, and the interrupt handler only looks at the front. */
+static struct list sleep_list;
+
+/* PIT cycles per timer tick. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Most ticks one PIT period can span (dynamic tick). */
+#define MAX_PERIOD_TICKS (65535 / TICK_CYCLES)
+
+/* Timer ticks the current PIT period spans.  Normally 1, more
+   while the CPU idles with nothing due (see timer_idle()). */
+static int period_ticks;
+
+/* PIT cycles of ticks cut short by timer_idle(), not yet counted. */
+static unsigned carry_cycles;
+
+/* Statistics. */
+static int64_t interrupt_cnt;       /* # of timer interrupts. */
+static uint64_t interrupt_cycles;   /* CPU cycles spent handling them. */
+
 static intr_handler_func timer_interrupt;
+static void timer_tick (void);
+static bool tick_pending (void);
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static uint64_t rdtsc (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -36,6 +67,9 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  period_ticks = 1;
+  seqlock_init (&ticks_seq);
+  list_init (&sleep_list);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -70,9 +104,15 @@ timer_calibrate (void)
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  int64_t t;
+  unsigned seq;
+
+  do 
+    {
+      seq = seqlock_read_begin (&ticks_seq);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seq, seq));
   return t;
 }
 
@@ -90,12 +130,95 @@ void
 timer_sleep (int64_t ticks) 
 {
   int64_t start = timer_ticks ();
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  /* Queue the thread in wakeup order and block it. */
+  old_level = intr_disable ();
+  t->wakeup_tick = start + ticks;
+  list_insert_ordered (&sleep_list, &t->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
+/* Called by the idle thread, with interrupts off, right before
+   it halts.  Nothing is ready to run, so instead of interrupting
+   every tick, let the PIT run until the next sleeper is due, as
+   far as its 16-bit counter reaches.  The interrupt handler
+   catches up on the ticks it skipped. */
+void
+timer_idle (void) 
+{
+  int64_t n = MAX_PERIOD_TICKS;
+  uint16_t left;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (period_ticks != 1)
+    return;                     /* Already stretched. */
+
+  /* Leave the tick the next sleeper is due on to the normal
+     rate, so that it is not woken up late. */
+  if (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick - ticks - 1 < n)
+        n = t->wakeup_tick - ticks - 1;
+    }
+  if (n <= 1)
+    return;
+
+  /* A tick that is already waiting to be handled would be taken
+     for the end of the long period. */
+  if (tick_pending ())
+    return;
+
+  /* Starting the count over cuts the current tick short; count
+     the cycles it already lasted towards a later tick. */
+  left = pit_read_count (0);
+  if (left <= TICK_CYCLES)
+    carry_cycles += TICK_CYCLES - left;
+  pit_configure_count (0, 2, n * TICK_CYCLES);
+  period_ticks = n;
+}
+
+/* Called with interrupts off by an interrupt handler that makes
+   a thread ready while the CPU idles.  If timer_idle() stretched
+   the PIT period, counts the ticks that have passed since, so
+   that the thread sees the current time, and goes back to one
+   interrupt per tick, so that its time slice is enforced. */
+void
+timer_resume (void) 
+{
+  unsigned elapsed;
+  int n;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (period_ticks == 1)
+    return;
+
+  /* Read the count before asking the PIC: if the period has not
+     ended by then, the count belongs to it.  If it has ended,
+     leave the whole period to the interrupt handler. */
+  elapsed = period_ticks * TICK_CYCLES - pit_read_count (0);
+  if (tick_pending ())
+    return;
+
+  pit_configure_channel (0, 2, TIMER_FREQ);
+  period_ticks = 1;
+  elapsed += carry_cycles;
+  carry_cycles = elapsed % TICK_CYCLES;
+  for (n = elapsed / TICK_CYCLES; n > 0; n--)
+    timer_tick ();
+}
+
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -159,21 +282,99 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Stores the number of timer interrupts so far in *CNT and the
+   CPU cycles spent handling them in *CYCLES. */
+void
+timer_interrupt_stats (int64_t *cnt, uint64_t *cycles) 
+{
+  enum intr_level old_level = intr_disable ();
+  *cnt = interrupt_cnt;
+  *cycles = interrupt_cycles;
+  intr_set_level (old_level);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" interrupts, %"PRIu64" cycles in handler\n",
+          interrupt_cnt, interrupt_cycles);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  uint64_t start = rdtsc ();
+  int n = period_ticks;
+
+  /* Back to one interrupt per tick after an idle period. */
+  if (n > 1) 
+    {
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      period_ticks = 1;
+    }
+  if (carry_cycles >= TICK_CYCLES) 
+    {
+      carry_cycles -= TICK_CYCLES;
+      n++;
+    }
+  while (n-- > 0)
+    timer_tick ();
+
+  interrupt_cnt++;
+  interrupt_cycles += rdtsc () - start;
+}
+
+/* Does the work of a single timer tick. */
+static void
+timer_tick (void) 
+{
+  seqlock_write_begin (&ticks_seq);
   ticks++;
+  seqlock_write_end (&ticks_seq);
+
+  /* Wake up the sleepers that are due, all at the front. */
+  while (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
   thread_tick ();
 }
 
+/* Returns true if a timer interrupt is waiting at the PIC to be
+   handled (OCW3: read the interrupt request register). */
+static bool
+tick_pending (void) 
+{
+  outb (0x20, 0x0a);
+  return (inb (0x20) & 0x01) != 0;
+}
+
+/* Orders sleeping threads by wakeup tick. */
+static bool
+wakeup_less (const struct list_elem *a, const struct list_elem *b,
+             void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->wakeup_tick
+          < list_entry (b, struct thread, elem)->wakeup_tick);
+}
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -27,6 +27,7 @@ typedef unsigned long elem_type;
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
+    size_t next;        /* Where bitmap_scan_and_flip_next() starts. */
     elem_type *bits;    /* Elements that represent bits. */
   };
 
@@ -68,6 +69,54 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none.
+   Whole elements without such a bit are skipped at once, and the
+   bit within an element is found with a single bsf. */
+static size_t
+find_bit (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+
+  while (start < end) 
+    {
+      elem_type e = (b->bits[elem_idx (start)] ^ flip) >> (start % ELEM_BITS);
+      if (e != 0) 
+        {
+          start += __builtin_ctzl (e);
+          return start < end ? start : end;
+        }
+      start = ROUND_DOWN (start, ELEM_BITS) + ELEM_BITS;
+    }
+  return end;
+}
+
+/* Returns the starting index of the first group of CNT
+   consecutive bits in B set to VALUE that begins at or after
+   START and ends at or before END, or BITMAP_ERROR if there is
+   none.  Jumps from run to run instead of trying every start. */
+static size_t
+scan_range (const struct bitmap *b, size_t start, size_t end, size_t cnt,
+            bool value) 
+{
+  if (cnt == 0)
+    return start;
+
+  while (end - start >= cnt) 
+    {
+      size_t run_end;
+
+      start = find_bit (b, start, end, value);
+      if (end - start < cnt)
+        break;
+      run_end = find_bit (b, start, start + cnt, !value);
+      if (run_end == start + cnt)
+        return start;
+      start = run_end;
+    }
+  return BITMAP_ERROR;
+}
 
 /* Creation and destruction. */
 
@@ -82,6 +131,7 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->next = 0;
       b->bits = malloc (byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
@@ -104,6 +154,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
   ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
   b->bit_cnt = bit_cnt;
+  b->next = 0;
   b->bits = (elem_type *) (b + 1);
   bitmap_set_all (b, false);
   return b;
@@ -250,16 +301,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_bit (b, start, start + cnt, value) != start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -298,15 +344,7 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
-  return BITMAP_ERROR;
+  return scan_range (b, start, b->bit_cnt, cnt, value);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -324,6 +362,33 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
     bitmap_set_multiple (b, idx, cnt, !value);
   return idx;
 }
+
+/* Like bitmap_scan_and_flip(), but starts where the previous call
+   on B left off instead of at a fixed index, wrapping around to
+   the start of B if nothing is found after that point.  Repeated
+   allocations then do not rescan the bits they already used up. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value) 
+{
+  size_t next, idx;
+
+  ASSERT (b != NULL);
+
+  next = b->next <= b->bit_cnt ? b->next : 0;
+  idx = scan_range (b, next, b->bit_cnt, cnt, value);
+  if (idx == BITMAP_ERROR && next > 0) 
+    {
+      size_t end = next + cnt - 1;
+      idx = scan_range (b, 0, end < b->bit_cnt ? end : b->bit_cnt,
+                        cnt, value);
+    }
+  if (idx != BITMAP_ERROR) 
+    {
+      bitmap_set_multiple (b, idx, cnt, !value);
+      b->next = idx + cnt;
+    }
+  return idx;
+}
 
 /* File input and output. */
 
@@ -9,6 +9,7 @@
 
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void putbuf_have_lock (const char *, size_t);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,6 +60,20 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* vprintf() formats its output into a staging buffer on the
+   caller's own stack, without holding the console lock, and then
+   writes it out in one piece.  Only output too long for the
+   buffer makes vprintf() take the lock while still formatting. */
+#define STAGE_SIZE 128
+
+struct vprintf_stage
+  {
+    char buf[STAGE_SIZE];       /* Formatted but unwritten output. */
+    size_t len;                 /* Number of bytes in BUF. */
+    bool locked;                /* Console lock already acquired? */
+    int char_cnt;               /* Number of characters formatted. */
+  };
+
 /* Enable console locking. */
 void
 console_init (void) 
@@ -125,13 +140,19 @@ console_locked_by_current_thread (void)
 int
 vprintf (const char *format, va_list args) 
 {
-  int char_cnt = 0;
+  struct vprintf_stage stage;
 
-  acquire_console ();
-  __vprintf (format, args, vprintf_helper, &char_cnt);
+  stage.len = 0;
+  stage.locked = false;
+  stage.char_cnt = 0;
+  __vprintf (format, args, vprintf_helper, &stage);
+
+  if (!stage.locked)
+    acquire_console ();
+  putbuf_have_lock (stage.buf, stage.len);
   release_console ();
 
-  return char_cnt;
+  return stage.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
@@ -153,8 +174,7 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  putbuf_have_lock (buffer, n);
   release_console ();
 }
 
@@ -171,11 +191,24 @@ putchar (int c)
 
 /* Helper function for vprintf(). */
 static void
-vprintf_helper (char c, void *char_cnt_) 
+vprintf_helper (char c, void *stage_) 
 {
-  int *char_cnt = char_cnt_;
-  (*char_cnt)++;
-  putchar_have_lock (c);
+  struct vprintf_stage *stage = stage_;
+
+  stage->char_cnt++;
+  if (stage->len >= STAGE_SIZE) 
+    {
+      /* Out of room: hold the console lock from here on, so that
+         the output still is not mixed with other threads'. */
+      if (!stage->locked) 
+        {
+          acquire_console ();
+          stage->locked = true;
+        }
+      putbuf_have_lock (stage->buf, stage->len);
+      stage->len = 0;
+    }
+  stage->buf[stage->len++] = c;
 }
 
 /* Writes C to the vga display and serial port.
@@ -189,3 +222,17 @@ putchar_have_lock (uint8_t c)
   serial_putc (c);
   vga_putc (c);
 }
+
+/* Writes the N characters in BUFFER to the vga display and
+   serial port.
+   The caller has already acquired the console lock if
+   appropriate. */
+static void
+putbuf_have_lock (const char *buffer, size_t n) 
+{
+  ASSERT (console_locked_by_current_thread ());
+  write_cnt += n;
+  serial_putbuf (buffer, n);
+  while (n-- > 0)
+    vga_putc (*buffer++);
+}
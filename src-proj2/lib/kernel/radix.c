@@ -0,0 +1,220 @@
+/* Radix tree.
+
+   See radix.h for basic information. */
+
+#include "radix.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Key bits indexed by each level, and levels of nodes. */
+#define LEVEL_BITS 5
+#define LEVEL_CNT 4
+
+/* Slots per node. */
+#define FANOUT ((size_t) 1 << LEVEL_BITS)
+
+/* A node.  At the last level the slots hold values, above it
+   they point to the nodes of the next level. */
+struct radix_node
+  {
+    void *slots[FANOUT];
+  };
+
+static void destroy_node (struct radix_node *, int level, size_t base,
+                          radix_action_func *);
+
+/* Returns the slot of a node at LEVEL, counting the top level as
+   0, that leads to KEY. */
+static size_t
+slot_idx (size_t key, int level)
+{
+  return (key >> (LEVEL_BITS * (LEVEL_CNT - 1 - level))) & (FANOUT - 1);
+}
+
+/* Reads *SLOT, which another thread may be storing to. */
+static void *
+load_slot (void *const *slot)
+{
+  return *(void *const volatile *) slot;
+}
+
+/* Stores VALUE in *SLOT for concurrent lookups to see.  Stores
+   are not reordered with older stores on x86, so a compiler
+   barrier is enough to make the contents of a new node visible
+   before the node itself. */
+static void
+store_slot (void **slot, void *value)
+{
+  asm volatile ("" : : : "memory");
+  *(void *volatile *) slot = value;
+}
+
+/* Initializes T as an empty tree. */
+void
+radix_init (struct radix_tree *t)
+{
+  t->root = NULL;
+  t->elem_cnt = 0;
+}
+
+/* Destroys tree T, first calling DESTRUCTOR, if it is non-null,
+   for each element in key order.  T is empty afterward and may be
+   used again.  No lookup may be running on T. */
+void
+radix_destroy (struct radix_tree *t, radix_action_func *destructor)
+{
+  if (t->root != NULL)
+    destroy_node (t->root, 0, 0, destructor);
+  radix_init (t);
+}
+
+/* Returns the value that T maps KEY to, or a null pointer if T
+   does not contain KEY. */
+void *
+radix_lookup (const struct radix_tree *t, size_t key)
+{
+  void *p = load_slot ((void *const *) &t->root);
+  int level;
+
+  ASSERT (key < RADIX_KEY_CNT);
+
+  for (level = 0; p != NULL && level < LEVEL_CNT; level++)
+    p = load_slot (&((struct radix_node *) p)->slots[slot_idx (key, level)]);
+  return p;
+}
+
+/* Maps KEY to VALUE, which must not be null, in T.  Returns
+   false if T already contains KEY or memory is exhausted. */
+bool
+radix_insert (struct radix_tree *t, size_t key, void *value)
+{
+  void **slot = (void **) &t->root;
+  int level;
+
+  ASSERT (key < RADIX_KEY_CNT);
+  ASSERT (value != NULL);
+
+  for (level = 0; level < LEVEL_CNT; level++)
+    {
+      struct radix_node *node = *slot;
+      if (node == NULL)
+        {
+          node = calloc (1, sizeof *node);
+          if (node == NULL)
+            return false;
+          store_slot (slot, node);
+        }
+      slot = &node->slots[slot_idx (key, level)];
+    }
+
+  if (*slot != NULL)
+    return false;
+  store_slot (slot, value);
+  t->elem_cnt++;
+  return true;
+}
+
+/* Removes KEY from T and returns the value it was mapped to, or
+   a null pointer if T does not contain KEY.  The nodes on the way
+   to KEY stay in place. */
+void *
+radix_delete (struct radix_tree *t, size_t key)
+{
+  void **slot = (void **) &t->root;
+  void *value;
+  int level;
+
+  ASSERT (key < RADIX_KEY_CNT);
+
+  for (level = 0; level < LEVEL_CNT; level++)
+    {
+      struct radix_node *node = *slot;
+      if (node == NULL)
+        return NULL;
+      slot = &node->slots[slot_idx (key, level)];
+    }
+
+  value = *slot;
+  if (value != NULL)
+    {
+      store_slot (slot, NULL);
+      t->elem_cnt--;
+    }
+  return value;
+}
+
+/* Returns the value of the element of T with the smallest key
+   that is at least *KEY and at most LAST, and stores that key in
+   *KEY.  Returns a null pointer if there is no such element.
+   Subtrees without nodes are skipped whole, so walking a sparse
+   range costs little more than its elements.
+
+   To visit every element in a range, advance *KEY past each one
+   returned:
+
+      size_t key = first;
+      while ((value = radix_next (t, &key, last)) != NULL)
+        {
+          ...do something with value...
+          key++;
+        }
+
+   The caller may delete the element just returned. */
+void *
+radix_next (const struct radix_tree *t, size_t *key, size_t last)
+{
+  ASSERT (last < RADIX_KEY_CNT);
+
+  while (*key <= last)
+    {
+      void *p = load_slot ((void *const *) &t->root);
+      size_t span = RADIX_KEY_CNT;      /* Keys under P's slot. */
+      int level;
+
+      for (level = 0; p != NULL && level < LEVEL_CNT; level++)
+        {
+          span /= FANOUT;
+          p = load_slot (&((struct radix_node *) p)->slots[slot_idx (*key,
+                                                                    level)]);
+        }
+      if (p != NULL)
+        return p;
+
+      /* Skip the rest of the empty slot *KEY falls in. */
+      *key = (*key / span + 1) * span;
+    }
+  return NULL;
+}
+
+/* Returns the number of elements in T. */
+size_t
+radix_size (const struct radix_tree *t)
+{
+  return t->elem_cnt;
+}
+
+/* Frees NODE, at LEVEL, and the nodes below it, first calling
+   DESTRUCTOR, if it is non-null, for each element.  BASE is the
+   smallest key under NODE. */
+static void
+destroy_node (struct radix_node *node, int level, size_t base,
+              radix_action_func *destructor)
+{
+  size_t span = RADIX_KEY_CNT;
+  size_t i;
+  int l;
+
+  for (l = 0; l <= level; l++)
+    span /= FANOUT;
+
+  for (i = 0; i < FANOUT; i++)
+    if (node->slots[i] != NULL)
+      {
+        if (level < LEVEL_CNT - 1)
+          destroy_node (node->slots[i], level + 1, base + i * span,
+                        destructor);
+        else if (destructor != NULL)
+          destructor (base + i, node->slots[i]);
+      }
+  free (node);
+}
@@ -28,7 +28,16 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_LOCKSTATS,              /* Prints lock contention statistics. */
+    SYS_FUTEX_WAIT,             /* Sleeps while a user int holds a value. */
+    SYS_FUTEX_WAKE,             /* Wakes threads sleeping on a user int. */
+    SYS_THREAD_CREATE,          /* Starts another thread in this process. */
+    SYS_THREAD_JOIN,            /* Waits for a thread of this process. */
+    SYS_THREAD_EXIT,            /* Ends the calling thread. */
+    SYS_MEMSTATS                /* Prints kernel memory usage. */
   };
 
 #endif /* lib/syscall-nr.h */
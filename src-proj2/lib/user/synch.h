@@ -0,0 +1,31 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutex built on futex_wait() and futex_wake().
+   Locking and unlocking a mutex nobody else wants stays entirely
+   in user mode; only contention enters the kernel. */
+struct mutex 
+  {
+    int state;          /* 0: unlocked, 1: locked, 2: locked, waiters. */
+  };
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable, used together with a mutex. */
+struct condvar 
+  {
+    int seq;            /* Bumped by every signal and broadcast. */
+    int waiters;        /* Threads in condvar_wait(). */
+  };
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *, struct mutex *);
+void condvar_broadcast (struct condvar *, struct mutex *);
+
+#endif /* lib/user/synch.h */
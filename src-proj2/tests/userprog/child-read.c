@@ -0,0 +1,18 @@
+/* Child process run by thread-kill-wait test.
+   Waits for a key on the console, which never comes. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+int
+main (void) 
+{
+  char c;
+
+  test_name = "child-read";
+
+  read (STDIN_FILENO, &c, 1);
+  fail ("read a key");
+  return 1;
+}
@@ -0,0 +1,42 @@
+/* Starts several threads in this process that add to a shared
+   counter under a mutex, joins them, and checks the total. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 1000
+
+static struct mutex mutex;
+static int counter;
+
+static void
+adder (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      mutex_lock (&mutex);
+      counter++;
+      mutex_unlock (&mutex);
+    }
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  mutex_init (&mutex);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (adder, NULL)) != TID_ERROR,
+           "thread_create %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == 0, "thread_join %d", i);
+  CHECK (thread_join (tids[0]) == -1, "thread_join 0 again");
+  CHECK (counter == THREAD_CNT * ITERATIONS, "counter is %d", counter);
+}
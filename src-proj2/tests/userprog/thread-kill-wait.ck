@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-kill-wait) begin
+(thread-kill-wait) thread_create reader
+(thread-kill-wait) thread_create waiter
+(thread-kill-wait) exiting
+thread-kill-wait: exit(57)
+EOF
+pass;
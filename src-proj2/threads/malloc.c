@@ -5,17 +5,21 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages blocks
+   of that size.  Size classes are 8 bytes apart up to 128 bytes
+   and a quarter of a power of 2 apart above that, each stretched
+   to use up its arena, so that a request wastes at most about a
+   quarter of its block, or a third in the largest class.  The
+   descriptor keeps a list of free blocks.  If the free list is
+   nonempty, one of its blocks is used to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
@@ -26,13 +30,34 @@
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
+   and give the arena back to the page allocator, unless the
+   descriptor has fewer than ARENA_KEEP such empty arenas, in which
+   case we keep it for the next time the free list runs dry.
+
+   In front of each free list sits a "magazine", a small stack of
+   free blocks that malloc() pops from and free() pushes onto.
+   Pintos runs on a single CPU, so the magazine is that CPU's
+   cache: it is guarded by turning interrupts off for a few
+   instructions instead of by the descriptor's lock.  Only when
+   the magazine is empty or full do we take the lock, and then we
+   move a batch of MAGAZINE_BATCH blocks at once.
 
    We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   because they're too big to fit twice in a single page with an
+   arena header.  We handle those by allocating just enough
+   contiguous pages with the page allocator, without any header,
+   and recording the allocation size on a list of large blocks.
+   A block is large exactly when it is page-aligned, since blocks
+   in arenas never start at the beginning of a page. */
+
+/* Blocks a magazine holds, and blocks moved between a magazine
+   and its free list at a time. */
+#define MAGAZINE_SIZE 16
+#define MAGAZINE_BATCH (MAGAZINE_SIZE / 2)
+
+/* Entirely free arenas a descriptor keeps instead of returning
+   them to the page allocator. */
+#define ARENA_KEEP 1
 
 /* Descriptor. */
 struct desc
@@ -40,7 +65,13 @@ struct desc
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
+    size_t empty_cnt;           /* Arenas on free_list with no block
+                                   in use. */
     struct lock lock;           /* Lock. */
+
+    /* Owned by the CPU; accessed with interrupts off. */
+    struct block *magazine[MAGAZINE_SIZE];  /* Free blocks. */
+    size_t magazine_cnt;        /* Number of blocks in magazine. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -50,8 +81,8 @@ struct desc
 struct arena 
   {
     unsigned magic;             /* Always set to ARENA_MAGIC. */
-    struct desc *desc;          /* Owning descriptor, null for big block. */
-    size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct desc *desc;          /* Owning descriptor. */
+    size_t free_cnt;            /* Free blocks. */
   };
 
 /* Free block. */
@@ -60,28 +91,97 @@ struct block
     struct list_elem free_elem; /* Free list element. */
   };
 
+/* Large block, bigger than any descriptor's blocks. */
+struct large_block
+  {
+    void *pages;                /* First page. */
+    size_t page_cnt;            /* Number of pages. */
+    struct list_elem elem;      /* Element in large_blocks. */
+  };
+
+/* Spacing of the smallest size classes. */
+#define SIZE_STEP 8
+
+/* Largest size with a descriptor. */
+#define MAX_SMALL_SIZE 2040
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Index in descs[] of the descriptor for a request of SIZE bytes
+   is size_to_desc[DIV_ROUND_UP (SIZE, SIZE_STEP)]. */
+static uint8_t size_to_desc[MAX_SMALL_SIZE / SIZE_STEP + 1];
+
+/* Large blocks in use. */
+static struct list large_blocks;
+static struct lock large_lock;
+
+/* Bytes in blocks handed out, and the most ever handed out.
+   Accessed with interrupts off, like the magazines. */
+static size_t used_bytes, peak_bytes;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static bool refill_magazine (struct desc *);
+static void drain_magazine (struct desc *);
+static void *malloc_large (size_t);
+static struct large_block *find_large_block (void *);
+static void add_desc (size_t block_size);
+static void count_bytes (size_t size, bool alloc);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) 
 {
-  size_t block_size;
-
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  size_t block_size, base, i;
+
+  for (block_size = 16; block_size <= 128; block_size += SIZE_STEP)
+    add_desc (block_size);
+  for (base = 128; base < MAX_SMALL_SIZE; base *= 2)
+    for (i = 1; i <= 4; i++)
+      add_desc (base + base / 4 * i);
+  ASSERT (descs[desc_cnt - 1].block_size == MAX_SMALL_SIZE);
+
+  /* Map each request size to the smallest descriptor that
+     satisfies it. */
+  for (i = 0, block_size = 0; block_size <= MAX_SMALL_SIZE;
+       block_size += SIZE_STEP) 
     {
-      struct desc *d = &descs[desc_cnt++];
-      ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-      list_init (&d->free_list);
-      lock_init (&d->lock);
+      while (descs[i].block_size < block_size)
+        i++;
+      size_to_desc[block_size / SIZE_STEP] = i;
     }
+
+  list_init (&large_blocks);
+  lock_init (&large_lock);
+}
+
+/* Adds a descriptor for blocks of at least BLOCK_SIZE bytes,
+   enlarged to fill out its arenas, unless the previous descriptor
+   already covers that size. */
+static void
+add_desc (size_t block_size) 
+{
+  size_t blocks_per_arena;
+  struct desc *d;
+
+  if (block_size > MAX_SMALL_SIZE)
+    block_size = MAX_SMALL_SIZE;
+  blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+  block_size = ROUND_DOWN ((PGSIZE - sizeof (struct arena))
+                           / blocks_per_arena, SIZE_STEP);
+  if (desc_cnt > 0 && descs[desc_cnt - 1].block_size >= block_size)
+    return;
+
+  d = &descs[desc_cnt++];
+  ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+  d->block_size = block_size;
+  d->blocks_per_arena = blocks_per_arena;
+  list_init (&d->free_list);
+  d->empty_cnt = 0;
+  d->magazine_cnt = 0;
+  lock_init (&d->lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -91,65 +191,33 @@ malloc (size_t size)
 {
   struct desc *d;
   struct block *b;
-  struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
     return NULL;
 
+  /* SIZE is too big for any descriptor. */
+  if (size > MAX_SMALL_SIZE)
+    return malloc_large (size);
+
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
-    {
-      /* SIZE is too big for any descriptor.
-         Allocate enough pages to hold SIZE plus an arena. */
-      size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-      a = palloc_get_multiple (0, page_cnt);
-      if (a == NULL)
-        return NULL;
+  d = &descs[size_to_desc[DIV_ROUND_UP (size, SIZE_STEP)]];
 
-      /* Initialize the arena to indicate a big block of PAGE_CNT
-         pages, and return it. */
-      a->magic = ARENA_MAGIC;
-      a->desc = NULL;
-      a->free_cnt = page_cnt;
-      return a + 1;
-    }
-
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* Pop a block off the magazine, refilling it from the free list
+     if it is empty. */
+  old_level = intr_disable ();
+  while (d->magazine_cnt == 0) 
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      intr_set_level (old_level);
+      if (!refill_magazine (d))
+        return NULL;
+      old_level = intr_disable ();
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  b = d->magazine[--d->magazine_cnt];
+  count_bytes (d->block_size, true);
+  intr_set_level (old_level);
   return b;
 }
 
@@ -178,11 +246,42 @@ calloc (size_t a, size_t b)
 static size_t
 block_size (void *block) 
 {
-  struct block *b = block;
-  struct arena *a = block_to_arena (b);
-  struct desc *d = a->desc;
+  if (pg_ofs (block) == 0) 
+    {
+      size_t page_cnt;
+
+      lock_acquire (&large_lock);
+      page_cnt = find_large_block (block)->page_cnt;
+      lock_release (&large_lock);
+      return PGSIZE * page_cnt;
+    }
+  else
+    return block_to_arena (block)->desc->block_size;
+}
 
-  return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
+/* Returns the number of bytes that can be used in BLOCK, which
+   must have been allocated with malloc(), calloc(), or realloc(),
+   or 0 if BLOCK is a null pointer. */
+size_t
+malloc_usable_size (void *block) 
+{
+  return block != NULL ? block_size (block) : 0;
+}
+
+/* Prints the bytes in blocks handed out, now and at most.  The
+   pages that hold them are counted by palloc_print_stats() under
+   the "malloc" tag. */
+void
+malloc_print_stats (void) 
+{
+  enum intr_level old_level;
+  size_t used, peak;
+
+  old_level = intr_disable ();
+  used = used_bytes;
+  peak = peak_bytes;
+  intr_set_level (old_level);
+  printf ("Malloc: %zu bytes in use, at most %zu\n", used, peak);
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
@@ -201,7 +300,17 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block;
+
+      /* Keep OLD_BLOCK if it is big enough but not twice too big. */
+      if (old_block != NULL) 
+        {
+          size_t old_size = block_size (old_block);
+          if (new_size <= old_size && new_size > old_size / 2)
+            return old_block;
+        }
+
+      new_block = malloc (new_size);
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -220,45 +329,48 @@ free (void *p)
 {
   if (p != NULL)
     {
-      struct block *b = p;
-      struct arena *a = block_to_arena (b);
-      struct desc *d = a->desc;
-      
-      if (d != NULL) 
+      if (pg_ofs (p) != 0) 
         {
           /* It's a normal block.  We handle it here. */
+          struct block *b = p;
+          struct desc *d = block_to_arena (b)->desc;
+          enum intr_level old_level;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
 
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Push the block onto the magazine, draining it into the
+             free list first if it is full. */
+          old_level = intr_disable ();
+          while (d->magazine_cnt == MAGAZINE_SIZE) 
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              intr_set_level (old_level);
+              drain_magazine (d);
+              old_level = intr_disable ();
             }
-
-          lock_release (&d->lock);
+          d->magazine[d->magazine_cnt++] = b;
+          count_bytes (d->block_size, false);
+          intr_set_level (old_level);
         }
       else
         {
-          /* It's a big block.  Free its pages. */
-          palloc_free_multiple (a, a->free_cnt);
-          return;
+          /* It's a large block.  Free its pages. */
+          struct large_block *lb;
+          enum intr_level old_level;
+
+          lock_acquire (&large_lock);
+          lb = find_large_block (p);
+          list_remove (&lb->elem);
+          lock_release (&large_lock);
+
+          old_level = intr_disable ();
+          count_bytes (PGSIZE * lb->page_cnt, false);
+          intr_set_level (old_level);
+
+          palloc_free_multiple (lb->pages, lb->page_cnt);
+          free (lb);
         }
     }
 }
@@ -274,9 +386,9 @@ block_to_arena (struct block *b)
   ASSERT (a->magic == ARENA_MAGIC);
 
   /* Check that the block is properly aligned for the arena. */
-  ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-  ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+  ASSERT (a->desc != NULL);
+  ASSERT (pg_ofs (b) >= sizeof *a);
+  ASSERT ((pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
 
   return a;
 }
@@ -292,3 +404,171 @@ arena_to_block (struct arena *a, size_t idx)
                            + sizeof *a
                            + idx * a->desc->block_size);
 }
+
+/* Allocates a large block of at least SIZE bytes straight from
+   the page allocator.  Returns a null pointer if memory is not
+   available. */
+static void *
+malloc_large (size_t size) 
+{
+  struct large_block *lb = malloc (sizeof *lb);
+  enum intr_level old_level;
+  if (lb == NULL)
+    return NULL;
+
+  lb->page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  lb->pages = palloc_get_multiple (PAL_TAG (PAL_TAG_MALLOC), lb->page_cnt);
+  if (lb->pages == NULL) 
+    {
+      free (lb);
+      return NULL;
+    }
+
+  lock_acquire (&large_lock);
+  list_push_front (&large_blocks, &lb->elem);
+  lock_release (&large_lock);
+
+  old_level = intr_disable ();
+  count_bytes (PGSIZE * lb->page_cnt, true);
+  intr_set_level (old_level);
+  return lb->pages;
+}
+
+/* Returns the record of the large block starting at PAGES.
+   large_lock must be held. */
+static struct large_block *
+find_large_block (void *pages) 
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&large_lock));
+
+  for (e = list_begin (&large_blocks); e != list_end (&large_blocks);
+       e = list_next (e)) 
+    {
+      struct large_block *lb = list_entry (e, struct large_block, elem);
+      if (lb->pages == pages)
+        return lb;
+    }
+  PANIC ("free of unknown large block %p", pages);
+}
+
+/* Moves up to MAGAZINE_BATCH blocks from D's free list into its
+   magazine, first adding a new arena to the free list if it is
+   empty.  Returns false if the free list is empty and no page is
+   available for a new arena. */
+static bool
+refill_magazine (struct desc *d) 
+{
+  enum intr_level old_level;
+
+  lock_acquire (&d->lock);
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      struct arena *a;
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (PAL_TAG (PAL_TAG_MALLOC));
+      if (a == NULL) 
+        {
+          lock_release (&d->lock);
+          return false; 
+        }
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+      d->empty_cnt++;
+    }
+
+  /* Get a batch of blocks from the free list. */
+  old_level = intr_disable ();
+  while (d->magazine_cnt < MAGAZINE_BATCH && !list_empty (&d->free_list)) 
+    {
+      struct block *b = list_entry (list_pop_front (&d->free_list),
+                                    struct block, free_elem);
+      struct arena *a = block_to_arena (b);
+      if (a->free_cnt-- == d->blocks_per_arena)
+        d->empty_cnt--;
+      d->magazine[d->magazine_cnt++] = b;
+    }
+  intr_set_level (old_level);
+
+  lock_release (&d->lock);
+  return true;
+}
+
+/* Moves MAGAZINE_BATCH blocks from D's magazine back to its free
+   list, giving arenas that become entirely unused back to the
+   page allocator beyond the ARENA_KEEP that D retains. */
+static void
+drain_magazine (struct desc *d) 
+{
+  struct block *batch[MAGAZINE_BATCH];
+  enum intr_level old_level;
+  size_t batch_cnt = 0;
+  size_t i;
+
+  lock_acquire (&d->lock);
+
+  old_level = intr_disable ();
+  while (batch_cnt < MAGAZINE_BATCH && d->magazine_cnt > 0)
+    batch[batch_cnt++] = d->magazine[--d->magazine_cnt];
+  intr_set_level (old_level);
+
+  for (i = 0; i < batch_cnt; i++) 
+    {
+      struct block *b = batch[i];
+      struct arena *a = block_to_arena (b);
+
+      /* Add block to free list. */
+      list_push_front (&d->free_list, &b->free_elem);
+
+      /* If the arena is now entirely unused, keep it or free it. */
+      if (++a->free_cnt >= d->blocks_per_arena) 
+        {
+          size_t j;
+
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          if (d->empty_cnt < ARENA_KEEP) 
+            {
+              d->empty_cnt++;
+              continue;
+            }
+          for (j = 0; j < d->blocks_per_arena; j++) 
+            {
+              struct block *b = arena_to_block (a, j);
+              list_remove (&b->free_elem);
+            }
+          palloc_free_page (a);
+        }
+    }
+
+  lock_release (&d->lock);
+}
+
+/* Counts a block of SIZE bytes as handed out if ALLOC is true, or
+   as given back otherwise.  Interrupts must be off. */
+static void
+count_bytes (size_t size, bool alloc) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (alloc) 
+    {
+      used_bytes += size;
+      if (used_bytes > peak_bytes)
+        peak_bytes = used_bytes;
+    }
+  else
+    used_bytes -= size;
+}
@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,22 +24,86 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy system.  Its free pages form
+   blocks of 2**K pages, aligned to 2**K pages from the pool base,
+   kept on one free list per order K.  An allocation of N pages
+   takes the smallest block of at least N pages, splitting bigger
+   blocks in halves as needed, and gives back the pages beyond N.
+   A freed block merges with its buddy, the other half of the
+   block it was split from, for as long as the buddy is free too.
+   Both take O(log n) time in the size of the pool.
+
+   The free blocks are guarded by turning interrupts off rather
+   than by a lock.  thread_schedule_tail() frees the page of a
+   dying thread in the middle of a thread switch, where nothing
+   may block, and the idle thread must not block either.  Since
+   allocating and freeing take O(log n) time, interrupts stay off
+   only briefly.
+
+   The idle thread zeroes free pages in the background and parks
+   up to ZERO_PAGES of them per pool, so that most PAL_ZERO
+   requests for a single page need not clear it themselves.  The
+   parked pages stay marked in use.  A request that finds no free
+   block big enough puts them back first.
+
+   Every allocation carries a tag that says what the pages are
+   for.  Each pool counts the pages it has handed out per tag and
+   remembers the highest counts, so that the statistics printed at
+   shutdown show where kernel memory went. */
+
+/* Blocks have at most 2**(ORDER_CNT - 1) pages. */
+#define ORDER_CNT 20
+
+/* Order map entry of a page that does not start a free block. */
+#define NOT_FREE 0xff
+
+/* Zeroed pages kept ready in each pool. */
+#define ZERO_PAGES 32
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    const char *name;                   /* Name, for statistics. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *orders;                    /* Order of the free block
+                                           starting at each page. */
+    /* Free blocks; accessed with interrupts off. */
+    struct list free_lists[ORDER_CNT];  /* Free blocks of each order. */
+    size_t free_cnt;                    /* Number of free pages. */
+    void *zeroed[ZERO_PAGES];           /* Pages zeroed while idle. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+
+    /* Accounting; accessed with interrupts off. */
+    uint8_t *tags;                      /* Tag of each allocation,
+                                           at its first page. */
+    size_t used_cnt;                    /* Pages handed out. */
+    size_t peak_used;                   /* Highest USED_CNT. */
+    size_t tag_cnt[PAL_TAG_CNT];        /* Pages handed out per tag. */
+    size_t tag_peak[PAL_TAG_CNT];       /* Highest TAG_CNT per tag. */
     uint8_t *base;                      /* Base of pool. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Names of the tags, for statistics. */
+static const char *tag_names[PAL_TAG_CNT] =
+  {"other", "user", "thread", "pagedir", "malloc", "slab", "cache"};
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t alloc_range (struct pool *, size_t page_cnt);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static bool zero_page (struct pool *);
+static void *take_zeroed (struct pool *);
+static void release_zeroed (struct pool *);
+static enum palloc_tag flags_tag (enum palloc_flags);
+static void account (struct pool *, size_t page_idx, size_t page_cnt,
+                     enum palloc_tag, bool alloc);
+static void print_pool_stats (const struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,15 +136,35 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* Take a page zeroed while idle, if there is one. */
+  if (page_cnt == 1 && (flags & PAL_ZERO)) 
+    {
+      pages = take_zeroed (pool);
+      if (pages != NULL) 
+        {
+          account (pool, pg_no (pages) - pg_no (pool->base), 1,
+                   flags_tag (flags), true);
+          return pages;
+        }
+    }
+
+  old_level = intr_disable ();
+  page_idx = alloc_range (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0) 
+    {
+      release_zeroed (pool);
+      page_idx = alloc_range (pool, page_cnt);
+    }
+  if (page_idx != BITMAP_ERROR)
+    bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -88,6 +173,7 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
   if (pages != NULL) 
     {
+      account (pool, page_idx, page_cnt, flags_tag (flags), true);
       if (flags & PAL_ZERO)
         memset (pages, 0, PGSIZE * page_cnt);
     }
@@ -118,6 +204,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -132,13 +219,17 @@ palloc_free_multiple (void *pages, size_t page_cnt)
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
+  account (pool, page_idx, page_cnt, pool->tags[page_idx], false);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_range (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +239,69 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a free page for a later PAL_ZERO request, user pool
+   first.  Called by the idle thread, so it never blocks.
+   Returns true if it zeroed a page, false if both pools already
+   have enough zeroed pages or it could not get one right now. */
+bool
+palloc_zero_idle (void) 
+{
+  return zero_page (&user_pool) || zero_page (&kernel_pool);
+}
+
+/* Prints the number of free pages and the largest free block of
+   each pool, to show how fragmented memory has become. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
+/* Stores the page counts of the user pool in *STATS if PAL_USER
+   is set in FLAGS, otherwise those of the kernel pool.  The
+   free counts are read with interrupts on, so they are only a
+   snapshot. */
+void
+palloc_get_stats (enum palloc_flags flags, struct palloc_stats *stats) 
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+  int order;
+  int tag;
+
+  stats->page_cnt = bitmap_size (pool->used_map);
+  stats->free_cnt = pool->free_cnt + pool->zeroed_cnt;
+  stats->largest_free = 0;
+  for (order = ORDER_CNT - 1; order >= 0; order--)
+    if (!list_empty (&pool->free_lists[order])) 
+      {
+        stats->largest_free = (size_t) 1 << order;
+        break;
+      }
+
+  old_level = intr_disable ();
+  stats->peak_used = pool->peak_used;
+  for (tag = 0; tag < PAL_TAG_CNT; tag++) 
+    {
+      stats->tag_cnt[tag] = pool->tag_cnt[tag];
+      stats->tag_peak[tag] = pool->tag_peak[tag];
+    }
+  intr_set_level (old_level);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map, order map, and tag map at its
+     base.  Calculate the space needed for them
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt) + 2 * page_cnt,
+                                  PGSIZE);
+  int order;
+  int tag;
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +309,23 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->name = name;
+  p->used_map = bitmap_create_in_buf (page_cnt, base,
+                                      bitmap_buf_size (page_cnt));
+  p->orders = (uint8_t *) base + bitmap_buf_size (page_cnt);
+  memset (p->orders, NOT_FREE, page_cnt);
+  p->tags = p->orders + page_cnt;
+  p->used_cnt = p->peak_used = 0;
+  for (tag = 0; tag < PAL_TAG_CNT; tag++)
+    p->tag_cnt[tag] = p->tag_peak[tag] = 0;
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free_lists[order]);
+  p->free_cnt = 0;
+  p->zeroed_cnt = 0;
   p->base = base + bm_pages * PGSIZE;
+
+  /* Every page starts out free. */
+  free_range (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +339,233 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the list element kept in free page PAGE_IDX of P. */
+static struct list_elem *
+page_elem (const struct pool *p, size_t page_idx) 
+{
+  return (struct list_elem *) (p->base + PGSIZE * page_idx);
+}
+
+/* Returns the index in P of the free page holding E. */
+static size_t
+elem_page (const struct pool *p, struct list_elem *e) 
+{
+  return ((uint8_t *) e - p->base) / PGSIZE;
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX on P's free
+   list for ORDER. */
+static void
+push_block (struct pool *p, size_t page_idx, int order) 
+{
+  p->orders[page_idx] = order;
+  list_push_front (&p->free_lists[order], page_elem (p, page_idx));
+}
+
+/* Takes the free block at PAGE_IDX off its free list in P. */
+static void
+remove_block (struct pool *p, size_t page_idx) 
+{
+  list_remove (page_elem (p, page_idx));
+  p->orders[page_idx] = NOT_FREE;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to P's free
+   blocks, merging it with its buddy for as long as the buddy is a
+   free block of the same order. */
+static void
+free_block (struct pool *p, size_t page_idx, int order) 
+{
+  size_t page_cnt = bitmap_size (p->used_map);
+
+  while (order < ORDER_CNT - 1) 
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+      if (buddy >= page_cnt || p->orders[buddy] != order)
+        break;
+      remove_block (p, buddy);
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  push_block (p, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages of P starting at PAGE_IDX, as the
+   largest aligned blocks that fit.  Interrupts must be off,
+   unless P is still being initialized. */
+static void
+free_range (struct pool *p, size_t page_idx, size_t page_cnt) 
+{
+  p->free_cnt += page_cnt;
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+      while (order < ORDER_CNT - 1
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (p, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Takes PAGE_CNT contiguous pages from P's free blocks and
+   returns the index of the first, or BITMAP_ERROR if no free
+   block is big enough.  Interrupts must be off. */
+static size_t
+alloc_range (struct pool *p, size_t page_cnt) 
+{
+  int want = 0;
+  int order;
+  size_t page_idx;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (want < ORDER_CNT && ((size_t) 1 << want) < page_cnt)
+    want++;
+  for (order = want; order < ORDER_CNT; order++)
+    if (!list_empty (&p->free_lists[order]))
+      break;
+  if (order >= ORDER_CNT)
+    return BITMAP_ERROR;
+
+  page_idx = elem_page (p, list_front (&p->free_lists[order]));
+  remove_block (p, page_idx);
+
+  /* Split off upper halves until the block is just big enough. */
+  while (order > want) 
+    {
+      order--;
+      push_block (p, page_idx + ((size_t) 1 << order), order);
+    }
+  p->free_cnt -= (size_t) 1 << order;
+
+  /* Give back the pages beyond PAGE_CNT. */
+  if (page_cnt < (size_t) 1 << order)
+    free_range (p, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Takes a free page from P, zeroes it, and parks it for
+   take_zeroed().  Returns false if P already has ZERO_PAGES
+   zeroed pages or has no free page. */
+static bool
+zero_page (struct pool *p) 
+{
+  enum intr_level old_level;
+  size_t page_idx;
+  void *page;
+
+  if (p->zeroed_cnt >= ZERO_PAGES)
+    return false;
+
+  old_level = intr_disable ();
+  page_idx = alloc_range (p, 1);
+  if (page_idx != BITMAP_ERROR)
+    bitmap_mark (p->used_map, page_idx);
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  page = p->base + PGSIZE * page_idx;
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  p->zeroed[p->zeroed_cnt++] = page;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Returns one of P's zeroed pages, or a null pointer if it has
+   none. */
+static void *
+take_zeroed (struct pool *p) 
+{
+  enum intr_level old_level;
+  void *page = NULL;
+
+  old_level = intr_disable ();
+  if (p->zeroed_cnt > 0)
+    page = p->zeroed[--p->zeroed_cnt];
+  intr_set_level (old_level);
+  return page;
+}
+
+/* Gives all of P's zeroed pages back to its free blocks.
+   Interrupts must be off. */
+static void
+release_zeroed (struct pool *p) 
+{
+  void *page;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while ((page = take_zeroed (p)) != NULL) 
+    {
+      size_t page_idx = pg_no (page) - pg_no (p->base);
+      bitmap_reset (p->used_map, page_idx);
+      free_range (p, page_idx, 1);
+    }
+}
+
+/* Returns the tag in FLAGS.  Untagged user pages are tagged
+   PAL_TAG_USER. */
+static enum palloc_tag
+flags_tag (enum palloc_flags flags) 
+{
+  unsigned tag = (unsigned) flags >> PAL_TAG_SHIFT;
+
+  ASSERT (tag < PAL_TAG_CNT);
+  if (tag == PAL_TAG_OTHER && (flags & PAL_USER))
+    tag = PAL_TAG_USER;
+  return tag;
+}
+
+/* Counts the PAGE_CNT pages of P starting at PAGE_IDX as handed
+   out for TAG if ALLOC is true, or as given back otherwise. */
+static void
+account (struct pool *p, size_t page_idx, size_t page_cnt,
+         enum palloc_tag tag, bool alloc) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (alloc) 
+    {
+      p->tags[page_idx] = tag;
+      p->used_cnt += page_cnt;
+      p->tag_cnt[tag] += page_cnt;
+      if (p->used_cnt > p->peak_used)
+        p->peak_used = p->used_cnt;
+      if (p->tag_cnt[tag] > p->tag_peak[tag])
+        p->tag_peak[tag] = p->tag_cnt[tag];
+    }
+  else 
+    {
+      ASSERT (p->tag_cnt[tag] >= page_cnt);
+      p->used_cnt -= page_cnt;
+      p->tag_cnt[tag] -= page_cnt;
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics of pool P: free pages, then the pages in
+   use and their high-water marks, overall and for each tag that
+   has been used. */
+static void
+print_pool_stats (const struct pool *p) 
+{
+  struct palloc_stats stats;
+  int tag;
+
+  palloc_get_stats (p == &user_pool ? PAL_USER : 0, &stats);
+  printf ("Palloc: %s: %zu of %zu pages free, largest free block %zu pages\n",
+          p->name, stats.free_cnt, stats.page_cnt, stats.largest_free);
+  printf ("Palloc: %s: %zu pages in use, at most %zu\n",
+          p->name, stats.page_cnt - stats.free_cnt, stats.peak_used);
+  for (tag = 0; tag < PAL_TAG_CNT; tag++)
+    if (stats.tag_peak[tag] > 0)
+      printf ("Palloc: %s: %s: %zu pages, at most %zu\n", p->name,
+              tag_names[tag], stats.tag_cnt[tag], stats.tag_peak[tag]);
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,44 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* What pages are for, for memory accounting.  Pass PAL_TAG (TAG)
+   along with the flags above.  Untagged pages count as
+   PAL_TAG_USER if PAL_USER is set, otherwise as PAL_TAG_OTHER. */
+enum palloc_tag
+  {
+    PAL_TAG_OTHER,              /* Anything else. */
+    PAL_TAG_USER,               /* User process pages. */
+    PAL_TAG_THREAD,             /* Threads and their kernel stacks. */
+    PAL_TAG_PAGEDIR,            /* Page directories and tables. */
+    PAL_TAG_MALLOC,             /* malloc() arenas and big blocks. */
+    PAL_TAG_SLAB,               /* Slab caches. */
+    PAL_TAG_CACHE,              /* File system and page caches. */
+    PAL_TAG_CNT                 /* Number of tags. */
+  };
+
+/* Flags that allocate pages for TAG. */
+#define PAL_TAG_SHIFT 8
+#define PAL_TAG(TAG) ((TAG) << PAL_TAG_SHIFT)
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
 
+/* Page counts of a pool. */
+struct palloc_stats
+  {
+    size_t page_cnt;            /* Pages in the pool. */
+    size_t free_cnt;            /* Free pages. */
+    size_t largest_free;        /* Pages in the largest free block. */
+    size_t peak_used;           /* Most pages ever in use. */
+    size_t tag_cnt[PAL_TAG_CNT];  /* Pages in use per tag. */
+    size_t tag_peak[PAL_TAG_CNT]; /* Most pages ever in use per tag. */
+  };
+
+void palloc_get_stats (enum palloc_flags, struct palloc_stats *);
+bool palloc_zero_idle (void);
+void palloc_print_stats (void);
+
 #endif /* threads/palloc.h */
@@ -34,6 +34,16 @@ struct exit_code_list_element{
    struct list_elem elem;               /* Element for list */
 };
 
+/* Record a thread of a user process other than its main thread,
+   kept by the main thread until the thread is joined */
+struct user_thread_element{
+   tid_t thread_tid;                    /* The corresponding thread's tid */
+   int stack_slot;                      /* Slot of the thread's user stack */
+   bool exited;                         /* The thread has exited */
+   bool joined;                         /* Some thread is joining it */
+   struct list_elem elem;               /* Element for list */
+};
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -103,6 +113,9 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at, if asleep. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
@@ -117,6 +130,11 @@ struct thread
     bool exited;                        /* Record whether the thread is exited */
     int exit_code;                      /* The exit code returned when the thread exits */
     struct list children_exit_code_list;/* A list used to record children threads' exit code*/
+    struct thread* main_t;              /* Main thread of this process, itself if it is one */
+    struct user_thread_element* ute;    /* Record of this thread in main_t, NULL for a main thread */
+    struct list user_threads_list;      /* Records of the other threads, main thread only */
+    unsigned stack_slots;               /* Stack slots in use by the other threads, main thread only */
+    bool dying;                         /* The process is exiting, main thread only */
 #endif
 
     /* Owned by thread.c. */
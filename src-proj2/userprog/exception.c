@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/process.h"
 #include "userprog/syscall.h"
 
 /* Number of page faults processed. */
@@ -90,6 +91,7 @@ kill (struct intr_frame *f)
       printf ("%s: dying due to interrupt %#04x (%s).\n",
               thread_name (), f->vec_no, intr_name (f->vec_no));
       intr_dump_frame (f);
+      process_set_dying (-1);
       thread_exit (); 
 
     case SEL_KCSEG:
@@ -157,13 +159,7 @@ page_fault (struct intr_frame *f)
    //        user ? "user" : "kernel");
 
 
-   struct thread *cur = thread_current();
-   cur->exit_code = -1;
-   enum intr_level old_level = intr_disable();
-   printf ("%s: exit(%d)\n", cur->name, -1);
-   intr_set_level (old_level);
-  
-   thread_exit();
+   exit(-1);          /* Ends the whole process */
   }
 
   /* To implement virtual memory, delete the rest of the function
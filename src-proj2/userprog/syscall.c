@@ -11,14 +11,18 @@
 #include "filesys/filesys.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "devices/input.h"
 #include "threads/synch.h"
+#include "userprog/futex.h"
 
 typedef int pid_t;
 
 struct lock file_lock;          /* Lock for file operations */
 static int global_fd = 1;       /* fd generator */
 struct list file_list;          /* List for storing all opened files */
+static struct slab_cache file_des_cache;    /* File descriptors */
+struct slab_cache exit_code_cache;          /* Exit codes kept for parents */
 
 static void syscall_handler (struct intr_frame *);
 
@@ -27,7 +31,11 @@ syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   lock_init(&file_lock);        /* Initialize file_lock */
+  lock_set_name(&file_lock, "file_lock");
   list_init(&file_list);        /* Initialize file list */
+  slab_cache_init(&file_des_cache, "file_des", sizeof(struct file_des), 0, NULL);
+  slab_cache_init(&exit_code_cache, "exit_code", sizeof(struct exit_code_list_element), 0, NULL);
+  futex_init();                 /* Initialize futex wait queues */
 }
 
 /* Bad pointer checker */
@@ -75,7 +83,7 @@ clear_files(struct thread* t)
     if(fdes->opener == t){
       list_remove(iter);
       file_close(fdes->file_ptr);
-      free(fdes);
+      slab_free(&file_des_cache, fdes);
     }
     iter = next_iter;
   }
@@ -96,7 +104,7 @@ syscall_handler (struct intr_frame *f)
   
   /* Check the interrupt code is valid or not */
   int intr_code = *(int*)(f->esp);
-  if(intr_code < SYS_HALT || intr_code > SYS_INUMBER){
+  if(intr_code < SYS_HALT || intr_code > SYS_MEMSTATS){
     exit(-1);
   }
   
@@ -211,6 +219,64 @@ syscall_handler (struct intr_frame *f)
       close(fd);
       break;
     }
+
+    case SYS_LOCKSTATS:
+    {
+      lockstats();
+      break;
+    }
+
+    case SYS_MEMSTATS:
+    {
+      memstats();
+      break;
+    }
+
+    case SYS_FUTEX_WAIT:
+    {
+      /* parse the arguments first */
+      int* uaddr = (int*)*((int*)(f->esp) + 1);
+      int val = *((int*)(f->esp) + 2);
+
+      f->eax = futex_wait(uaddr, val);
+      break;
+    }
+
+    case SYS_FUTEX_WAKE:
+    {
+      /* parse the arguments first */
+      int* uaddr = (int*)*((int*)(f->esp) + 1);
+      int cnt = *((int*)(f->esp) + 2);
+
+      f->eax = futex_wake(uaddr, cnt);
+      break;
+    }
+
+    case SYS_THREAD_CREATE:
+    {
+      /* parse the arguments first */
+      void* eip = (void*)*((int*)(f->esp) + 1);
+      void* func = (void*)*((int*)(f->esp) + 2);
+      void* arg = (void*)*((int*)(f->esp) + 3);
+
+      f->eax = user_thread_create(eip, func, arg);
+      break;
+    }
+
+    case SYS_THREAD_JOIN:
+    {
+      /* parse the arguments first */
+      tid_t tid = *((int*)(f->esp) + 1);
+
+      f->eax = user_thread_join(tid);
+      break;
+    }
+
+    case SYS_THREAD_EXIT:
+    {
+      user_thread_exit();
+      break;
+    }
   }
 }
 
@@ -226,11 +292,20 @@ void
 exit(int status)
 {
   struct thread *cur = thread_current();
+
+  /* The whole process ends, with the status of its first exit() */
+  process_set_dying(status);
+  status = cur->main_t->exit_code;
   cur->exit_code = status;
 
+  /* The main thread reports it, the other threads end quietly */
+  if(cur->main_t != cur){
+    thread_exit();
+  }
+
   /* Construct a exit_code_element */
   if(cur->parent_t != NULL){
-    struct exit_code_list_element* exit_element = malloc(sizeof(struct exit_code_list_element));
+    struct exit_code_list_element* exit_element = slab_alloc(&exit_code_cache);
     exit_element->thread_tid = cur->tid;
     exit_element->thread_exit_code = status;
 
@@ -315,11 +390,11 @@ open(const char* file)
   struct file_des* des;
 
   if(file_opened != NULL){
-    des = (struct file_des*)malloc(sizeof(struct file_des));
+    des = slab_alloc(&file_des_cache);
     des->file_ptr = file_opened;
     des->fd = ++global_fd;                       /* Set the fd */
     des->size = file_length(file_opened);        /* Set the size of file */
-    des->opener = thread_current();              /* Set the opener thread */
+    des->opener = thread_current()->main_t;      /* Set the opener process */
     list_push_back(&file_list, &(des->filelem)); /* Push this descriptor into list */
 
     lock_release(&file_lock);
@@ -366,7 +441,9 @@ read(int fd, void *buffer, unsigned size)
   else if(fd == STDIN_FILENO){      /* If STDIN mode */
     void* ptr = buffer;
     while(!bad_ptr(ptr + 1) && (ptr - buffer) < size - 1){    /* check bad ptr or oversize */
-      *(uint8_t*)ptr = input_getc();
+      if(!input_getc_unless(process_is_dying, (uint8_t*)ptr)){ /* the process is dying, see process_set_dying() */
+        break;
+      }
       ptr ++;
     }
     *(uint8_t*)ptr = 0;                                       /* Fill the 0 at the end */
@@ -479,14 +556,99 @@ close(int fd)
   struct file_des *f = find_des_by_fd(fd);    /* Find the target file descriptor */
 
   /* Check the file is valid or not and check the closer is also the opener or not */
-  if(f == NULL || f->opener != thread_current()){
+  if(f == NULL || f->opener != thread_current()->main_t){
     goto done;
   }
   list_remove(&(f->filelem));
   file_close(f->file_ptr);
-  free(f);
+  slab_free(&file_des_cache, f);
 
 done:
   lock_release(&file_lock);
   return;
-}
\ No newline at end of file
+}
+
+/* syscall: print contention statistics of the profiled kernel locks */
+void
+lockstats(void)
+{
+  lock_print_stats();
+  return;
+}
+
+/* syscall: print how kernel memory is used, by pool, allocation
+   tag, malloc() and slab cache */
+void
+memstats(void)
+{
+  palloc_print_stats();
+  malloc_print_stats();
+  slab_print_stats();
+  return;
+}
+
+/* syscall: sleep while *UADDR holds VAL, until futex_wake().
+   Returns 0 once woken, -1 if *UADDR did not hold VAL */
+int
+futex_wait(int* uaddr, int val)
+{
+  /* Check the word is valid and aligned */
+  if(bad_ptr((const char*)uaddr) || (uintptr_t)uaddr % sizeof(int) != 0){
+    exit(-1);
+  }
+
+  enum futex_result result = futex_queue_wait(thread_current()->pagedir, uaddr, val);
+  if(result == FUTEX_NOT_PRESENT){    /* Pages are never evicted, it is gone */
+    exit(-1);
+  }
+  return result == FUTEX_WOKEN ? 0 : -1;
+}
+
+/* syscall: wake up to CNT threads sleeping on UADDR.
+   Returns the number of threads woken */
+int
+futex_wake(int* uaddr, int cnt)
+{
+  /* UADDR is only a key here, it is never read */
+  if(uaddr == NULL || !is_user_vaddr(uaddr) || (uintptr_t)uaddr % sizeof(int) != 0){
+    exit(-1);
+  }
+
+  return futex_queue_wake(thread_current()->pagedir, uaddr, cnt);
+}
+
+/* syscall: start a thread in this process running EIP in user
+   mode, called with FUNC and ARG, on a stack of its own.  Returns
+   its tid, or -1 if it cannot be created */
+tid_t
+user_thread_create(void* eip, void* func, void* arg)
+{
+  /* A bad FUNC or ARG only hurts the new thread, but EIP must at
+     least be a user address */
+  if(eip == NULL || !is_user_vaddr(eip)){
+    exit(-1);
+  }
+  return process_thread_create((void (*) (void))eip, func, arg);
+}
+
+/* syscall: wait for thread TID of this process to exit.
+   Returns 0 once it has, -1 if TID cannot be joined */
+int
+user_thread_join(tid_t tid)
+{
+  return process_thread_join(tid);
+}
+
+/* syscall: end the calling thread.  For the main thread this
+   ends the process with status 0, after the other threads */
+void
+user_thread_exit(void)
+{
+  struct thread* cur = thread_current();
+
+  if(cur->main_t != cur){
+    thread_exit();
+  }
+  process_wait_threads();
+  exit(0);
+}
@@ -1,16 +1,19 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include "threads/thread.h"
+#include "threads/slab.h"
 
 typedef int pid_t;
 
+extern struct slab_cache exit_code_cache;   /* Exit codes kept for parents */
+
 /* File descriptor */
 struct file_des
 {
   int fd;                             /* File descriptor number */
   int size;                           /* Size of this file */
   struct file *file_ptr;              /* The pointer of this file */
-  struct thread* opener;              /* The thread open this file */
+  struct thread* opener;              /* Main thread of the process open this file */
   struct list_elem filelem;           /* Element for list */
 };
 
@@ -29,6 +32,13 @@ int write(int fd, const void *buffer, unsigned size);
 void seek(int fd, unsigned position);
 unsigned tell(int fd);
 void close(int fd);
+void lockstats(void);
+void memstats(void);
+int futex_wait(int* uaddr, int val);
+int futex_wake(int* uaddr, int cnt);
+tid_t user_thread_create(void* eip, void* func, void* arg);
+int user_thread_join(tid_t tid);
+void user_thread_exit(void);
 
 /* Helper functions */
 int bad_ptr(const char* file);
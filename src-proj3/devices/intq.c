@@ -38,20 +38,54 @@ uint8_t
 intq_getc (struct intq *q) 
 {
   uint8_t byte;
-  
+
+  intq_getc_unless (q, NULL, &byte);
+  return byte;
+}
+
+/* Like intq_getc(), but gives up and returns false instead of
+   sleeping once STOP, if non-null, returns true.  A thread
+   sleeping here rechecks STOP when woken by intq_kick().
+   Otherwise stores the removed byte in *BYTE and returns true. */
+bool
+intq_getc_unless (struct intq *q, bool (*stop) (void), uint8_t *byte) 
+{
   ASSERT (intr_get_level () == INTR_OFF);
   while (intq_empty (q)) 
     {
       ASSERT (!intr_context ());
+      if (stop != NULL && stop ())
+        return false;
       lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
+      if (intq_empty (q) && (stop == NULL || !stop ()))
+        wait (q, &q->not_empty);
       lock_release (&q->lock);
+
+      /* Kicked with Q still empty: let a reader queued on the
+         lock check its own STOP before we take the lock again. */
+      if (intq_empty (q))
+        thread_yield ();
     }
   
-  byte = q->buf[q->tail];
+  *byte = q->buf[q->tail];
   q->tail = next (q->tail);
   signal (q, &q->not_full);
-  return byte;
+  return true;
+}
+
+/* Wakes up the thread sleeping for a byte in Q, if any, even
+   though Q is still empty, so that it rechecks its stop
+   condition.  See intq_getc_unless(). */
+void
+intq_kick (struct intq *q) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (q->not_empty != NULL) 
+    {
+      thread_unblock (q->not_empty);
+      q->not_empty = NULL;
+    }
 }
 
 /* Adds BYTE to the end of Q.
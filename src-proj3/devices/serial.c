@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <stdio.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,13 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear receive and transmit FIFOs. */
+
+/* Bytes the transmit FIFO holds once it reports empty. */
+#define TX_FIFO_SIZE 16
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,12 +58,31 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted: a circular buffer, much larger than
+   an intq, so that bursts of console output are absorbed without
+   making the writer wait for the port. */
+#define TXQ_SIZE 4096
+static uint8_t txq_buf[TXQ_SIZE];
+static size_t txq_head;                 /* Next free slot. */
+static size_t txq_tail;                 /* Next byte to transmit. */
+
+/* Only one thread at a time waits for room in the queue;
+   the others wait for TXQ_LOCK. */
+static struct lock txq_lock;
+static struct thread *txq_waiter;
+
+/* Statistics. */
+static int64_t queued_cnt;      /* Bytes queued for transmission. */
+static int64_t blocked_cnt;     /* Bytes whose writer slept for room. */
+static int64_t polled_cnt;      /* Bytes that went out by polling instead. */
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void putc_queue (uint8_t, enum intr_level);
 static void write_ier (void);
+static bool txq_empty (void);
+static bool txq_full (void);
+static uint8_t txq_getc (void);
 static intr_handler_func serial_interrupt;
 
 /* Initializes the serial port device for polling mode.
@@ -71,7 +97,7 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  lock_init (&txq_lock);
   mode = POLL;
 } 
 
@@ -87,6 +113,10 @@ serial_init_queue (void)
     init_poll ();
   ASSERT (mode == POLL);
 
+  /* Let each transmit interrupt hand the UART a whole FIFO's
+     worth of bytes instead of a single one. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR);
+
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
@@ -112,34 +142,54 @@ serial_putc (uint8_t byte)
     {
       /* Otherwise, queue a byte and update the interrupt enable
          register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
-        {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
-        }
-
-      intq_putc (&txq, byte); 
+      putc_queue (byte, old_level);
       write_ier ();
     }
   
   intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUFFER to the serial port, disabling
+   interrupts and updating the interrupt enable register once for
+   the whole buffer rather than once per byte. */
+void
+serial_putbuf (const char *buffer, size_t n) 
+{
+  enum intr_level old_level;
+
+  if (mode != QUEUE)
+    {
+      while (n-- > 0)
+        serial_putc (*buffer++);
+      return;
+    }
+
+  old_level = intr_disable ();
+  while (n-- > 0)
+    putc_queue (*buffer++, old_level);
+  write_ier ();
+  intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (!txq_empty ())
+    putc_poll (txq_getc ());
   intr_set_level (old_level);
 }
 
+/* Prints serial port statistics. */
+void
+serial_print_stats (void) 
+{
+  printf ("Serial: %lld bytes queued, %lld blocked, %lld polled\n",
+          queued_cnt, blocked_cnt, polled_cnt);
+}
+
 /* The fullness of the input buffer may have changed.  Reassess
    whether we should block receive interrupts.
    Called by the input buffer routines when characters are added
@@ -182,7 +232,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (!txq_empty ())
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +255,79 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Adds BYTE to the transmit queue.  OLD_LEVEL is the interrupt
+   level the caller had before disabling interrupts. */
+static void
+putc_queue (uint8_t byte, enum intr_level old_level) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (txq_full ()) 
+    {
+      if (old_level == INTR_OFF) 
+        {
+          /* Interrupts are off and the transmit queue is full.
+             If we wanted to wait for the queue to empty,
+             we'd have to reenable interrupts.
+             That's impolite, so we'll send a character via
+             polling instead. */
+          polled_cnt++;
+          putc_poll (txq_getc ()); 
+        }
+      else
+        {
+          /* Sleep until the interrupt handler makes room. */
+          blocked_cnt++;
+          write_ier ();
+          lock_acquire (&txq_lock);
+          while (txq_full ())
+            {
+              txq_waiter = thread_current ();
+              thread_block ();
+            }
+          lock_release (&txq_lock);
+        }
+    }
+
+  txq_buf[txq_head] = byte;
+  txq_head = (txq_head + 1) % TXQ_SIZE;
+  queued_cnt++;
+}
+
+/* Returns true if the transmit queue is empty. */
+static bool
+txq_empty (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return txq_head == txq_tail;
+}
+
+/* Returns true if the transmit queue is full. */
+static bool
+txq_full (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return (txq_head + 1) % TXQ_SIZE == txq_tail;
+}
+
+/* Removes and returns the next byte to transmit, which must
+   exist, and wakes up a writer waiting for room. */
+static uint8_t
+txq_getc (void) 
+{
+  uint8_t byte;
+
+  ASSERT (!txq_empty ());
+  byte = txq_buf[txq_tail];
+  txq_tail = (txq_tail + 1) % TXQ_SIZE;
+  if (txq_waiter != NULL) 
+    {
+      thread_unblock (txq_waiter);
+      txq_waiter = NULL;
+    }
+  return byte;
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +341,15 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* Once the transmitter has drained its FIFO, refill all of it
+     without polling the line status between bytes. */
+  if ((inb (LSR_REG) & LSR_THRE) != 0) 
+    {
+      int i;
+
+      for (i = 0; i < TX_FIFO_SIZE && !txq_empty (); i++)
+        outb (THR_REG, txq_getc ());
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -0,0 +1,52 @@
+#ifndef __LIB_KERNEL_RADIX_H
+#define __LIB_KERNEL_RADIX_H
+
+/* Radix tree.
+
+   Maps page numbers, that is, 20-bit keys such as pg_no() of a
+   user or kernel address, to non-null pointers.  The tree has
+   four levels of nodes of 32 slots each, every level indexing
+   five bits of the key, so a lookup always takes four steps, and
+   the pages of one region share their nodes.  Nodes are created
+   as keys are inserted.
+
+   Lookups and radix_next() take no lock and may run while one
+   thread inserts or deletes.  A node is filled in before it is
+   linked into the tree, and no node is freed until
+   radix_destroy(), so a lookup never sees a half-built node or
+   freed memory; it sees each key either before or after a
+   concurrent change.  Insertions, deletions, and radix_destroy()
+   must be serialized by the caller. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Keys are less than this. */
+#define RADIX_KEY_CNT ((size_t) 1 << 20)
+
+/* Radix tree. */
+struct radix_tree
+  {
+    struct radix_node *root;    /* Top-level node, or null. */
+    size_t elem_cnt;            /* Number of elements in tree. */
+  };
+
+/* Performs some operation on the element mapping KEY to VALUE. */
+typedef void radix_action_func (size_t key, void *value);
+
+/* Basic life cycle. */
+void radix_init (struct radix_tree *);
+void radix_destroy (struct radix_tree *, radix_action_func *);
+
+/* Search, insertion, deletion. */
+void *radix_lookup (const struct radix_tree *, size_t key);
+bool radix_insert (struct radix_tree *, size_t key, void *value);
+void *radix_delete (struct radix_tree *, size_t key);
+
+/* Iteration. */
+void *radix_next (const struct radix_tree *, size_t *key, size_t last);
+
+/* Information. */
+size_t radix_size (const struct radix_tree *);
+
+#endif /* lib/kernel/radix.h */
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex) begin
+(futex) futex_wait on a changed value
+(futex) futex_wake with no sleepers
+(futex) mutex_trylock
+(futex) mutex_trylock while held
+(futex) mutex_lock
+(futex) condvar_signal and condvar_broadcast
+(futex) end
+futex: exit(0)
+EOF
+pass;
@@ -21,6 +21,7 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -30,6 +31,7 @@
 #include "userprog/tss.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/page_cache.h"
 #else
 #include "tests/threads/tests.h"
 #endif
@@ -119,6 +121,8 @@ main (void)
 
 #ifdef VM
   initialize_frame_table();
+  supp_page_init();
+  pcache_init();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -171,7 +175,8 @@ paging_init (void)
   size_t page;
   extern char _start, _end_kernel_text;
 
-  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                        | PAL_TAG (PAL_TAG_PAGEDIR));
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
     {
@@ -183,7 +188,8 @@ paging_init (void)
 
       if (pd[pde_idx] == 0)
         {
-          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                | PAL_TAG (PAL_TAG_PAGEDIR));
           pd[pde_idx] = pde_create (pt);
         }
 
@@ -266,6 +272,8 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lockprof"))
+        lock_profiling = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -392,6 +400,7 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lockprof          Profile contention on named kernel locks.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
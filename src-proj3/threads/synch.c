@@ -27,11 +27,49 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Lock profiling.  Each named lock gets a profile, updated only
+   by the thread that holds the lock, so the lock itself keeps the
+   profile consistent.  Times are in CPU cycles. */
+bool lock_profiling;
+
+#define LOCK_PROFILE_CNT 16     /* Most locks that can be named. */
+#define LOCK_TOP_WAITERS 3      /* Waiters remembered per lock. */
+
+/* A thread that waited for a lock. */
+struct lock_waiter 
+  {
+    tid_t tid;                  /* Thread identifier. */
+    char name[16];              /* Thread name. */
+    uint64_t wait_cycles;       /* Total time spent waiting. */
+  };
+
+/* Contention statistics of one lock. */
+struct lock_profile 
+  {
+    const char *name;           /* Lock name. */
+    uint64_t acquire_cnt;       /* # of acquisitions. */
+    uint64_t contended_cnt;     /* # of acquisitions that had to wait. */
+    uint64_t wait_cycles;       /* Total time spent waiting. */
+    uint64_t max_wait_cycles;   /* Longest single wait. */
+    uint64_t hold_cycles;       /* Total time held. */
+    uint64_t acquired_at;       /* When the current holder got it. */
+    struct lock_waiter top[LOCK_TOP_WAITERS]; /* Longest waiters. */
+  };
+
+static struct lock_profile profiles[LOCK_PROFILE_CNT];
+static int profile_cnt;
+
+static void lock_acquire_profiled (struct lock *);
+static void record_waiter (struct lock_profile *, struct thread *,
+                           uint64_t wait_cycles);
+static uint64_t rdtsc (void);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -178,6 +216,7 @@ lock_init (struct lock *lock)
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
+  lock->profile = NULL;
   sema_init (&lock->semaphore, 1);
 }
 
@@ -196,7 +235,10 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down (&lock->semaphore);
+  if (lock->profile != NULL && lock_profiling)
+    lock_acquire_profiled (lock);
+  else
+    sema_down (&lock->semaphore);
   lock->holder = thread_current ();
 }
 
@@ -215,8 +257,15 @@ lock_try_acquire (struct lock *lock)
   ASSERT (!lock_held_by_current_thread (lock));
 
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) 
+    {
+      lock->holder = thread_current ();
+      if (lock->profile != NULL && lock_profiling) 
+        {
+          lock->profile->acquire_cnt++;
+          lock->profile->acquired_at = rdtsc ();
+        }
+    }
   return success;
 }
 
@@ -231,6 +280,8 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  if (lock->profile != NULL && lock_profiling)
+    lock->profile->hold_cycles += rdtsc () - lock->profile->acquired_at;
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -336,3 +387,308 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes readers-writer lock RW.  Any number of readers may
+   hold RW at once, or else a single writer.
+
+   RW prefers writers: once a writer holds or waits for RW, new
+   readers queue up behind it on WRITE_LOCK, so a steady stream of
+   readers cannot starve writers.  Queueing there also donates the
+   readers' priority to the writer holding RW. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->write_lock);
+  sema_init (&rw->drained, 0);
+  rw->readers = 0;
+  rw->writers = 0;
+  rw->draining = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (rw->writers > 0) 
+    {
+      /* Wait our turn behind the writers. */
+      lock_acquire (&rw->write_lock);
+      rw->readers++;
+      lock_release (&rw->write_lock);
+    }
+  else
+    rw->readers++;
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out lets a waiting writer in. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->draining) 
+    {
+      rw->draining = false;
+      sema_up (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until the writers before us
+   are done and every reader has left.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writers++;
+  lock_acquire (&rw->write_lock);
+  while (rw->readers > 0) 
+    {
+      rw->draining = true;
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  old_level = intr_disable ();
+  rw->writers--;
+  lock_release (&rw->write_lock);
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->write_lock);
+}
+
+/* Names RW for lock profiling.  Only writers and the readers
+   that queue behind them are counted. */
+void
+rwlock_set_name (struct rwlock *rw, const char *name) 
+{
+  ASSERT (rw != NULL);
+
+  lock_set_name (&rw->write_lock, name);
+}
+
+/* Initializes sequence lock SL.  A sequence lock protects a small
+   value that is read far more often than written, such as a
+   64-bit counter.  Readers take no lock at all: they note the
+   sequence number, copy the value, and start over if a write
+   happened meanwhile.  Writers run with interrupts off, so they
+   exclude each other and must not sleep.
+
+   A reader looks like this:
+
+     do 
+       {
+         seq = seqlock_read_begin (&sl);
+         copy = value;
+       }
+     while (seqlock_read_retry (&sl, seq)); */
+void
+seqlock_init (struct seqlock *sl) 
+{
+  ASSERT (sl != NULL);
+
+  sl->seq = 0;
+}
+
+/* Begins a read of the value protected by SL and returns the
+   sequence number to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *sl) 
+{
+  unsigned seq;
+
+  for (;;) 
+    {
+      seq = sl->seq;
+      barrier ();
+      if ((seq & 1) == 0)
+        return seq;
+
+      /* A writer on another processor is in the middle. */
+      asm volatile ("pause");
+    }
+}
+
+/* Returns true if the value protected by SL may have changed
+   since seqlock_read_begin() returned SEQ, in which case the
+   reader must start over. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned seq) 
+{
+  barrier ();
+  return sl->seq != seq;
+}
+
+/* Begins a write of the value protected by SL.  Interrupts stay
+   off until the matching seqlock_write_end(). */
+void
+seqlock_write_begin (struct seqlock *sl) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  sl->seq++;
+  barrier ();
+  sl->old_level = old_level;
+}
+
+/* Ends a write of the value protected by SL. */
+void
+seqlock_write_end (struct seqlock *sl) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (sl->seq & 1);
+
+  barrier ();
+  sl->seq++;
+  intr_set_level (sl->old_level);
+}
+
+/* Names LOCK, so that its contention is profiled when the kernel
+   runs with -lockprof.  NAME must stay valid forever.  Only the
+   first LOCK_PROFILE_CNT locks named get a profile. */
+void
+lock_set_name (struct lock *lock, const char *name) 
+{
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  if (profile_cnt < LOCK_PROFILE_CNT) 
+    {
+      struct lock_profile *p = &profiles[profile_cnt++];
+      memset (p, 0, sizeof *p);
+      p->name = name;
+      lock->profile = p;
+    }
+}
+
+/* Prints the contention statistics of every named lock, if lock
+   profiling is enabled. */
+void
+lock_print_stats (void) 
+{
+  int i, j;
+
+  if (!lock_profiling)
+    return;
+
+  for (i = 0; i < profile_cnt; i++) 
+    {
+      struct lock_profile *p = &profiles[i];
+
+      printf ("Lock %s: %"PRIu64" acquires, %"PRIu64" contended, "
+              "%"PRIu64" cycles waiting (max %"PRIu64"), "
+              "%"PRIu64" cycles held\n",
+              p->name, p->acquire_cnt, p->contended_cnt,
+              p->wait_cycles, p->max_wait_cycles, p->hold_cycles);
+      for (j = 0; j < LOCK_TOP_WAITERS; j++)
+        if (p->top[j].wait_cycles > 0)
+          printf ("  waiter %s (tid %d): %"PRIu64" cycles\n",
+                  p->top[j].name, p->top[j].tid, p->top[j].wait_cycles);
+    }
+}
+
+/* Acquires LOCK, counting the acquisition in its profile and, if
+   it had to wait, the time it waited.  The profile is updated
+   after LOCK is ours. */
+static void
+lock_acquire_profiled (struct lock *lock) 
+{
+  struct lock_profile *p = lock->profile;
+
+  if (!sema_try_down (&lock->semaphore)) 
+    {
+      uint64_t start = rdtsc ();
+      uint64_t wait;
+
+      sema_down (&lock->semaphore);
+      wait = rdtsc () - start;
+      p->contended_cnt++;
+      p->wait_cycles += wait;
+      if (wait > p->max_wait_cycles)
+        p->max_wait_cycles = wait;
+      record_waiter (p, thread_current (), wait);
+    }
+  p->acquire_cnt++;
+  p->acquired_at = rdtsc ();
+}
+
+/* Adds WAIT_CYCLES to T's total in P's longest waiters, making
+   room by dropping the shortest one if T is new and waited longer
+   than that. */
+static void
+record_waiter (struct lock_profile *p, struct thread *t,
+               uint64_t wait_cycles) 
+{
+  struct lock_waiter *w, *shortest = &p->top[0];
+
+  for (w = p->top; w < p->top + LOCK_TOP_WAITERS; w++) 
+    {
+      if (w->wait_cycles > 0 && w->tid == t->tid) 
+        {
+          w->wait_cycles += wait_cycles;
+          return;
+        }
+      if (w->wait_cycles < shortest->wait_cycles)
+        shortest = w;
+    }
+  if (wait_cycles > shortest->wait_cycles) 
+    {
+      shortest->tid = t->tid;
+      strlcpy (shortest->name, t->name, sizeof shortest->name);
+      shortest->wait_cycles = wait_cycles;
+    }
+}
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
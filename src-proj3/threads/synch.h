@@ -3,6 +3,7 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore 
@@ -22,6 +23,7 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct lock_profile *profile; /* Contention statistics, if named. */
   };
 
 void lock_init (struct lock *);
@@ -30,6 +32,13 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Lock profiling, for locks given a name.
+   Enabled by kernel command-line option "-lockprof". */
+extern bool lock_profiling;
+
+void lock_set_name (struct lock *, const char *name);
+void lock_print_stats (void);
+
 /* Condition variable. */
 struct condition 
   {
@@ -41,6 +50,37 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    struct lock write_lock;     /* Held by the writer, queues the rest. */
+    struct semaphore drained;   /* Upped when the last reader leaves. */
+    int readers;                /* # of readers holding the lock. */
+    int writers;                /* # of writers holding or waiting. */
+    bool draining;              /* True if a writer waits on DRAINED. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+void rwlock_set_name (struct rwlock *, const char *name);
+
+/* Sequence lock. */
+struct seqlock 
+  {
+    unsigned seq;               /* Odd while a write is in progress. */
+    enum intr_level old_level;  /* Interrupt level before the write. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned seq);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -145,6 +146,7 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  lock_print_stats ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -175,7 +177,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = palloc_get_page (PAL_ZERO | PAL_TAG (PAL_TAG_THREAD));
   if (t == NULL)
     return TID_ERROR;
 
@@ -254,6 +256,12 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
+
+  /* An interrupt ends an idle period: catch up on the ticks that
+     timer_idle() let pass before T gets to run. */
+  if (intr_context () && thread_current () == idle_thread)
+    timer_resume ();
+
   list_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
   intr_set_level (old_level);
@@ -434,10 +442,19 @@ idle (void *idle_started_ UNUSED)
 
   for (;;) 
     {
+      /* Zero free pages for PAL_ZERO requests until there is
+         nothing left to zero or another thread becomes ready. */
+      while (list_empty (&ready_list) && palloc_zero_idle ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
 
+      /* Nothing is ready: stop the periodic tick until something
+         is due. */
+      timer_idle ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -521,11 +538,18 @@ init_thread (struct thread *t, const char *name, int priority)
 
   /* Initialize the list of children's exit status */
   list_init(&(t->children_exit_code_list));
+
+  t->main_t = t;                      /* By default, a thread is its own process */
+  t->ute = NULL;
+  list_init(&(t->user_threads_list)); /* Initialize other threads' records */
+  t->stack_slots = 0;
+  t->dying = false;
 #endif
 
 #ifdef VM
   t->sp = NULL;                       /* Initialize the stack pointer as NULL*/
   list_init(&t->mmap_file_list);      /* Initialize the memory-mapped file */
+  lock_init(&t->page_table_lock);     /* Initialize the page table lock */
 #endif
 
   old_level = intr_disable ();
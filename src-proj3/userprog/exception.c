@@ -4,11 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/process.h"
+#include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 
-/* The lowest address of user stack */
-#define USER_STACK_BASE 0x08048000
-
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
@@ -94,6 +93,7 @@ kill (struct intr_frame *f)
       printf ("%s: dying due to interrupt %#04x (%s).\n",
               thread_name (), f->vec_no, intr_name (f->vec_no));
       intr_dump_frame (f);
+      process_set_dying (-1);
       thread_exit (); 
 
     case SEL_KCSEG:
@@ -174,44 +174,41 @@ page_fault (struct intr_frame *f)
       process_terminate();
    }
    else{
+      /* Hold the page table lock from the lookup until the page is
+         in, so that another thread of this process cannot load or
+         unmap the same page meanwhile */
+      struct lock* page_table_lock = &thread_current()->main_t->page_table_lock;
+      bool loaded = false;
+      lock_acquire(page_table_lock);
+
       /* Check whether this is a lazy load */
-      struct supp_page* spge = find_fake_pte(&thread_current()->page_table,
+      struct supp_page* spge = find_fake_pte(&thread_current()->main_t->page_table,
                                              pg_round_down(fault_addr));
-      if(spge == NULL){             /* NO corresponding page */
-         if(!(fault_addr < USER_STACK_BASE || esp - 32 > fault_addr)){
+      if(pagedir_get_page(thread_current()->pagedir, fault_addr) != NULL){
+         loaded = true;             /* Another thread loaded it first */
+      }
+      else if(spge == NULL){        /* NO corresponding page */
+         if(is_request_extra_stack(fault_addr, esp)){
             /* Try to grow stack */
-            if(!grow_stack(fault_addr)){
-               // printf("exception error2\n");
-               process_terminate();
-            }
-            return;
-         }
-         else{
-            // printf("exception error3\n");
-            process_terminate();
+            loaded = grow_stack(fault_addr);
          }
       }
       else{                         /* Corresponding page exists */
-         if(spge->type == LAZY_LOAD){       /* This is a fake page */
+         if(spge->type == LAZY_LOAD || spge->type == FILE_MAPPED){    /* This is a fake page */
             /* Try to lazy load, convert fake page to real page */
-            if(!fake2real_page_convert(spge)){
-               // printf("exception error4\n");
-               process_terminate();
-            }
-            return;
+            loaded = fake2real_page_convert(spge);
          }
          else{                      /* Need to reclaimation or impossible case */
-            // printf("Do reclaimation\n");
             ASSERT(spge->type == EVICTED);
-            // printf("ke bu ke yi write ne?: %d\n", spge->writable);
-            if(!try_to_do_reclaimation(spge)){
-               // printf("exception error5\n");
-               process_terminate();
-            }
-            // printf("reclaimation finish\n");
-            return;
-         }  
+            loaded = try_to_do_reclaimation(spge);
+         }
+      }
+
+      lock_release(page_table_lock);
+      if(!loaded){
+         process_terminate();
       }
+      return;
    }
 
    /* To implement virtual memory, delete the rest of the function
@@ -228,8 +225,5 @@ page_fault (struct intr_frame *f)
 void
 process_terminate(void)
 {
-  struct thread *cur = thread_current();
-  cur->exit_code = -1;
-  printf ("%s: exit(%d)\n", cur->name, -1);
-  thread_exit();
+  exit(-1);             /* Ends the whole process */
 }
\ No newline at end of file
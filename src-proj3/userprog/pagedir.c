@@ -17,7 +17,7 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  uint32_t *pd = palloc_get_page (PAL_TAG (PAL_TAG_PAGEDIR));
   if (pd != NULL)
     memcpy (pd, init_page_dir, PGSIZE);
   return pd;
@@ -47,8 +47,7 @@ pagedir_destroy (uint32_t *pd)
             /* ******Old******* */
 
             /* ******New******* */
-            struct frame* fe = find_frame_table_entry_by_frame(pte_get_page (*pte));
-            free_frame(fe);
+            free_frame_of_page(pte_get_page (*pte));
             /* ******New******* */
           }
         palloc_free_page (pt);
@@ -79,7 +78,7 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
     {
       if (create)
         {
-          pt = palloc_get_page (PAL_ZERO);
+          pt = palloc_get_page (PAL_ZERO | PAL_TAG (PAL_TAG_PAGEDIR));
           if (pt == NULL) 
             return NULL; 
       
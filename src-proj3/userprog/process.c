@@ -5,9 +5,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
+#include "devices/input.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -21,9 +23,12 @@
 #include "userprog/syscall.h"
 #include "vm/frame.h"
 #include "vm/sup_page.h"
+#include "vm/swap.h"
 
 static thread_func start_process NO_RETURN;
 static bool load (char **file_name, void (**eip) (void), void **esp, int argc);
+static bool user_threads_exited (struct thread *main_t);
+static void free_thread_stack (struct thread *t);
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -126,7 +131,7 @@ start_process (void *file_name_)
   int argc = 0;                      /* Count of arguments passed in on one command line. */
 
   /* Initialize this process's page_table */
-  hash_init(&cur->page_table, compute_page_hash_value, compare_page_hash_value, NULL);
+  radix_init(&cur->page_table);
 
   /* argv[0] is the real file name, and remaining are arguments */
   /* argc = 1(real file name) + # of arguments */
@@ -207,7 +212,7 @@ process_wait (tid_t child_tid)
       if(ece->thread_tid == child_tid){
         list_remove(iter);
         int return_code = ece->thread_exit_code;      
-        free(ece);
+        slab_free(&exit_code_cache, ece);
         return return_code;
       }
     }
@@ -230,14 +235,15 @@ process_wait (tid_t child_tid)
     }
     else{
       /* Check the child thread is waited already or not */
-      if(target_thread->waited != 0 || target_thread->status == THREAD_DYING){
+      if(target_thread->waited != 0 || target_thread->status == THREAD_DYING
+         || target_thread->main_t != target_thread){     /* Not a process, see thread_join() */
         return -1;
       }
       else{
         target_thread->waited = 1;
         
         lock_acquire(&(cur->loading_lock));
-        while(find_thread_by_tid(child_tid) != NULL){
+        while(find_thread_by_tid(child_tid) != NULL && !process_is_dying()){   /* woken by process_set_dying() */
           cond_wait(&(cur->loading_cond), &(cur->loading_lock));
         }
         lock_release(&(cur->loading_lock));
@@ -259,7 +265,7 @@ process_wait (tid_t child_tid)
         int exit_status = -1;
         if(return_exit_element != NULL){
           exit_status = return_exit_element->thread_exit_code;
-          free(return_exit_element);
+          slab_free(&exit_code_cache, return_exit_element);
         }
         return exit_status;
       }
@@ -274,6 +280,19 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* The other threads of this process run in its address space,
+     so wait for them to exit before tearing anything down */
+  if(cur->main_t == cur){
+    process_set_dying(cur->exit_code);
+    process_wait_threads();
+    lock_acquire(&(cur->loading_lock));
+    while(!list_empty(&(cur->user_threads_list))){
+      struct list_elem* e = list_pop_front(&(cur->user_threads_list));
+      free(list_entry(e, struct user_thread_element, elem));
+    }
+    lock_release(&(cur->loading_lock));
+  }
+
   /* Clear thread's children list */
   for(struct list_elem* iter = list_begin(&(cur->children_t_list));
                         iter != list_end(&(cur->children_t_list));
@@ -290,7 +309,7 @@ process_exit (void)
                                                      struct exit_code_list_element,
                                                      elem);
     list_remove(iter);
-    free(ece);
+    slab_free(&exit_code_cache, ece);
   }
   
   /* Allow write */
@@ -310,14 +329,34 @@ process_exit (void)
 
 #endif
   
+  /* Another thread of a process gives back its stack, then stops
+     using the address space before the main thread destroys it */
+  if(cur->ute != NULL){
+    free_thread_stack(cur);
+    cur->pagedir = NULL;
+    pagedir_activate(NULL);
+  }
+
   if(cur->parent_t != NULL){
     list_remove(&cur->childelem);       /* remove current thread from its parent's children list */
     lock_acquire(&(cur->parent_t->loading_lock));
     list_remove (&cur->allelem);        /* remove current thread from all_list */
+    if(cur->ute != NULL){               /* parent_t is the main thread, tell its joiners */
+      cur->parent_t->stack_slots &= ~(1u << cur->ute->stack_slot);
+      cur->ute->exited = true;
+    }
     cond_broadcast(&(cur->parent_t->loading_cond), &(cur->parent_t->loading_lock));
     lock_release(&(cur->parent_t->loading_lock));
   }
   
+  #ifdef VM
+  /* Eviction leaves the frames of a process alone while its page
+     table is locked, keep it locked until both tables are gone */
+  if(cur->main_t == cur){
+    lock_acquire(&cur->page_table_lock);
+  }
+  #endif
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -334,14 +373,17 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
-  
-  /* Clear all files opened by current thread */
-  clear_files(cur);
 
   #ifdef VM
   /* Clear this process's page table */
-  hash_destroy(&cur->page_table, free_page_table_entry);
+  if(cur->main_t == cur){
+    radix_destroy(&cur->page_table, free_page_table_entry);
+    lock_release(&cur->page_table_lock);
+  }
   #endif
+  
+  /* Clear all files opened by current thread */
+  clear_files(cur);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -533,8 +575,11 @@ load (char **file_name, void (**eip) (void), void **esp, int argc)
                   zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
                 }
 
-              if (!lazy_load (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable)){
+              lock_acquire(&t->page_table_lock);
+              bool reserved = lazy_load (file, file_page, (void *) mem_page,
+                                         read_bytes, zero_bytes, writable);
+              lock_release(&t->page_table_lock);
+              if (!reserved){
                 goto done;
               }
             }
@@ -546,7 +591,10 @@ load (char **file_name, void (**eip) (void), void **esp, int argc)
     }
 
   /* Set up stack. */
-  if (!setup_stack (esp, file_name, argc)){
+  lock_acquire(&t->page_table_lock);
+  bool stacked = setup_stack (esp, file_name, argc);
+  lock_release(&t->page_table_lock);
+  if (!stacked){
     goto done;
   }
 
@@ -803,4 +851,373 @@ install_page (void *upage, void *kpage, bool writable)
      address, then map our page there. */
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
-}
\ No newline at end of file
+}
+
+/* Multi-threaded processes.  The threads of a process share the
+   page directory, file descriptors and supplemental page table
+   of the main thread, which keeps records of the other threads
+   and hands out their stack slots under its loading_lock.  The main thread
+   outlives the others: process_exit() waits for them first.  Once
+   any thread calls exit() or is killed, the process is dying and
+   every thread ends on its next return to user mode. */
+
+/* Arguments passed from process_thread_create() to start_thread() */
+struct thread_start_args{
+  struct thread* main_t;                /* Main thread of the process */
+  struct user_thread_element* ute;      /* Record of the new thread */
+  void (*eip) (void);                   /* User entry point */
+  void* func;                           /* First argument of EIP */
+  void* arg;                            /* Second argument of EIP */
+  bool success;                         /* Stack set up successfully or not */
+  struct semaphore started;             /* Upped once SUCCESS is known */
+};
+
+static thread_func start_thread NO_RETURN;
+static bool setup_thread_stack (void **esp, int slot, void *func, void *arg);
+static void wait_thread_exited (struct thread *main_t,
+                                struct user_thread_element *ute);
+
+/* Returns the top of the user stack in stack slot SLOT */
+static uint8_t*
+thread_stack_top (int slot)
+{
+  return (uint8_t*)PHYS_BASE - USER_MAIN_STACK_SIZE - slot * USER_THREAD_STACK_SIZE;
+}
+
+/* Returns true if UADDR lies in the user stack region of the
+   current thread: the main stack for the main thread, its stack
+   slot for another thread.  The lowest page of each region is a
+   guard page that never gets mapped, so a stack overflowing its
+   region faults instead of running into the next one */
+bool
+process_stack_contains (const void *uaddr)
+{
+  struct thread* cur = thread_current();
+  uint8_t* top = (uint8_t*)PHYS_BASE;
+  size_t size = USER_MAIN_STACK_SIZE;
+
+  if(cur->ute != NULL){
+    top = thread_stack_top(cur->ute->stack_slot);
+    size = USER_THREAD_STACK_SIZE;
+  }
+  return (uint8_t*)uaddr >= top - size + PGSIZE && (uint8_t*)uaddr < top;
+}
+
+/* Starts a new thread in the current process that runs EIP in
+   user mode as if called with arguments FUNC and ARG, on its own
+   user stack.  Returns the new thread's tid, or TID_ERROR if the
+   thread or its stack cannot be created */
+tid_t
+process_thread_create (void (*eip) (void), void *func, void *arg)
+{
+  struct thread* cur = thread_current();
+  struct thread* main_t = cur->main_t;
+  struct thread_start_args args;
+  int slot;
+
+  struct user_thread_element* ute = malloc(sizeof(struct user_thread_element));
+  if(ute == NULL){
+    return TID_ERROR;
+  }
+
+  /* Find a free stack slot */
+  lock_acquire(&(main_t->loading_lock));
+  for(slot = 0; slot < USER_THREAD_MAX; slot ++){
+    if(!(main_t->stack_slots & (1u << slot))){
+      break;
+    }
+  }
+  if(slot == USER_THREAD_MAX){
+    lock_release(&(main_t->loading_lock));
+    free(ute);
+    return TID_ERROR;
+  }
+  main_t->stack_slots |= 1u << slot;
+  ute->thread_tid = TID_ERROR;
+  ute->stack_slot = slot;
+  ute->exited = false;
+  ute->joined = true;               /* Nobody may join it before it is set up */
+  list_push_back(&(main_t->user_threads_list), &(ute->elem));
+  lock_release(&(main_t->loading_lock));
+
+  args.main_t = main_t;
+  args.ute = ute;
+  args.eip = eip;
+  args.func = func;
+  args.arg = arg;
+  args.success = false;
+  sema_init(&args.started, 0);
+
+  tid_t tid = thread_create(cur->name, PRI_DEFAULT, start_thread, &args);
+  if(tid == TID_ERROR){
+    lock_acquire(&(main_t->loading_lock));
+    main_t->stack_slots &= ~(1u << slot);
+    list_remove(&(ute->elem));
+    lock_release(&(main_t->loading_lock));
+    free(ute);
+    return TID_ERROR;
+  }
+  sema_down(&args.started);         /* ARGS lives on this stack */
+
+  if(!args.success){                /* The thread is exiting, reap it */
+    wait_thread_exited(main_t, ute);
+    return TID_ERROR;
+  }
+
+  lock_acquire(&(main_t->loading_lock));
+  ute->thread_tid = tid;
+  ute->joined = false;
+  lock_release(&(main_t->loading_lock));
+  return tid;
+}
+
+/* Waits for thread TID of the current process to exit.  Returns
+   0 once it has, or -1 immediately if TID is not a thread of this
+   process other than its main thread and the caller, or if
+   another thread is already joining it */
+int
+process_thread_join (tid_t tid)
+{
+  struct thread* cur = thread_current();
+  struct thread* main_t = cur->main_t;
+  struct user_thread_element* target = NULL;
+
+  if(tid == cur->tid){
+    return -1;
+  }
+
+  lock_acquire(&(main_t->loading_lock));
+  for(struct list_elem* iter = list_begin(&(main_t->user_threads_list));
+                        iter != list_end(&(main_t->user_threads_list));
+                        iter = list_next(iter)){
+    struct user_thread_element* ute = list_entry(iter, struct user_thread_element, elem);
+    if(ute->thread_tid == tid){
+      target = ute;
+      break;
+    }
+  }
+  if(target == NULL || target->joined){
+    lock_release(&(main_t->loading_lock));
+    return -1;
+  }
+  target->joined = true;
+  lock_release(&(main_t->loading_lock));
+
+  wait_thread_exited(main_t, target);
+  return 0;
+}
+
+/* A thread function that joins the process of ARGS_->main_t,
+   sets up a user stack, and starts running in user mode */
+static void
+start_thread (void *args_)
+{
+  struct thread_start_args* args = args_;
+  struct thread* cur = thread_current();
+  struct intr_frame if_;
+
+  /* Become a child of the main thread rather than of the creator,
+     which may exit first */
+  enum intr_level old_level = intr_disable();
+  list_remove(&cur->childelem);
+  cur->parent_t = args->main_t;
+  list_push_back(&(args->main_t->children_t_list), &cur->childelem);
+  intr_set_level(old_level);
+
+  cur->main_t = args->main_t;
+  cur->ute = args->ute;
+  cur->pagedir = cur->main_t->pagedir;
+  process_activate();
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = args->eip;
+  bool success = setup_thread_stack(&if_.esp, cur->ute->stack_slot, args->func, args->arg);
+
+  args->success = success;
+  sema_up(&args->started);          /* ARGS is gone after this */
+  if(!success){
+    thread_exit();
+  }
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits until every thread of the current process other than its
+   main thread, which must be the caller, has exited */
+void
+process_wait_threads (void)
+{
+  struct thread* cur = thread_current();
+
+  ASSERT(cur->main_t == cur);
+
+  lock_acquire(&(cur->loading_lock));
+  while(!user_threads_exited(cur)){
+    cond_wait(&(cur->loading_cond), &(cur->loading_lock));
+  }
+  lock_release(&(cur->loading_lock));
+  return;
+}
+
+/* Marks the process of the current thread dying with exit status
+   STATUS, unless it already is, and wakes its threads sleeping on
+   futexes, in wait() or for a key, so that they all get back to user
+   mode.  Each of its threads ends there, see process_check_dying() */
+void
+process_set_dying (int status)
+{
+  struct thread* main_t = thread_current()->main_t;
+  bool newly_dying = false;
+
+  enum intr_level old_level = intr_disable();
+  if(!main_t->dying){
+    main_t->dying = true;
+    main_t->exit_code = status;
+    newly_dying = true;
+  }
+  intr_set_level(old_level);
+
+  if(!newly_dying){                     /* Whoever set it woke them */
+    return;
+  }
+
+  futex_queue_wake_all(main_t->pagedir);
+  input_kick();
+
+  /* A thread recorded in user_threads_list and not exited yet stays in
+     all_list while main_t's loading_lock is held, see process_exit() */
+  lock_acquire(&(main_t->loading_lock));
+  cond_broadcast(&(main_t->loading_cond), &(main_t->loading_lock));
+  for(struct list_elem* iter = list_begin(&(main_t->user_threads_list));
+                        iter != list_end(&(main_t->user_threads_list));
+                        iter = list_next(iter)){
+    struct user_thread_element* ute = list_entry(iter, struct user_thread_element, elem);
+    if(ute->exited){
+      continue;
+    }
+    old_level = intr_disable();
+    struct thread* t = find_thread_by_tid(ute->thread_tid);
+    intr_set_level(old_level);
+    if(t != NULL){
+      lock_acquire(&(t->loading_lock));
+      cond_broadcast(&(t->loading_cond), &(t->loading_lock));
+      lock_release(&(t->loading_lock));
+    }
+  }
+  lock_release(&(main_t->loading_lock));
+  return;
+}
+
+/* Returns true if the process of the current thread is dying */
+bool
+process_is_dying (void)
+{
+  return thread_current()->main_t->dying;
+}
+
+/* Ends the current thread if its process is dying, with the status
+   the process dies with.  Called on every return to user mode */
+void
+process_check_dying (void)
+{
+  struct thread* cur = thread_current();
+
+  if(cur->main_t->dying){
+    intr_enable();
+    exit(cur->main_t->exit_code);
+  }
+  return;
+}
+
+/* Returns true if every thread of MAIN_T's process other than
+   MAIN_T has exited.  MAIN_T's loading_lock must be held */
+static bool
+user_threads_exited (struct thread *main_t)
+{
+  ASSERT(lock_held_by_current_thread(&(main_t->loading_lock)));
+
+  for(struct list_elem* iter = list_begin(&(main_t->user_threads_list));
+                        iter != list_end(&(main_t->user_threads_list));
+                        iter = list_next(iter)){
+    struct user_thread_element* ute = list_entry(iter, struct user_thread_element, elem);
+    if(!ute->exited){
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Waits, holding MAIN_T's loading_lock, until the thread recorded
+   by UTE has exited, then frees UTE */
+static void
+wait_thread_exited (struct thread *main_t, struct user_thread_element *ute)
+{
+  lock_acquire(&(main_t->loading_lock));
+  while(!ute->exited){
+    cond_wait(&(main_t->loading_cond), &(main_t->loading_lock));
+  }
+  list_remove(&(ute->elem));
+  lock_release(&(main_t->loading_lock));
+  free(ute);
+  return;
+}
+
+/* Gives stack slot SLOT its first page, which grows on demand
+   like the main stack, then pushes ARG, FUNC and a null return
+   address as a call would */
+static bool
+setup_thread_stack (void **esp, int slot, void *func, void *arg)
+{
+  uint8_t* top = thread_stack_top(slot);
+  struct lock* page_table_lock = &thread_current()->main_t->page_table_lock;
+  lock_acquire(page_table_lock);
+  bool grown = grow_stack(top - PGSIZE);
+  lock_release(page_table_lock);
+  if(!grown){
+    return false;
+  }
+
+  *esp = top;
+  *esp = *esp - 4;
+  *(void**)(*esp) = arg;
+  *esp = *esp - 4;
+  *(void**)(*esp) = func;
+  *esp = *esp - 4;
+  *(void**)(*esp) = NULL;
+  return true;
+}
+
+/* Frees the pages and swap slots of T's stack slot and removes
+   them from the process's supplemental page table */
+static void
+free_thread_stack (struct thread *t)
+{
+  uint8_t* top = thread_stack_top(t->ute->stack_slot);
+  size_t key = pg_no(top - USER_THREAD_STACK_SIZE);
+  struct supp_page* spge;
+
+  /* Only the pages the thread touched have entries */
+  lock_acquire(&t->main_t->page_table_lock);
+  while((spge = radix_next(&t->main_t->page_table, &key, pg_no(top) - 1)) != NULL){
+    void* upage = pg_round_down(spge->user_vaddr);
+    key ++;
+    if(spge->type == EVICTED){
+      free_swap_slot(spge->swap_idx);
+    }
+    else{
+      void* kpage = pagedir_get_page(t->pagedir, upage);
+      if(kpage != NULL){
+        pagedir_clear_page(t->pagedir, upage);
+        free_frame_of_page(kpage);
+      }
+    }
+    radix_delete(&t->main_t->page_table, pg_no(upage));
+    supp_page_free(spge);
+  }
+  lock_release(&t->main_t->page_table_lock);
+  return;
+}
@@ -8,4 +8,21 @@ int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+/* User stacks of the threads of a process other than its main
+   thread.  The main thread's stack may grow down to
+   PHYS_BASE - USER_MAIN_STACK_SIZE; below that are
+   USER_THREAD_MAX slots of USER_THREAD_STACK_SIZE bytes each.
+   The lowest page of each stack region is left unmapped. */
+#define USER_MAIN_STACK_SIZE (8 * 1024 * 1024)
+#define USER_THREAD_STACK_SIZE (64 * 1024)
+#define USER_THREAD_MAX 32
+
+tid_t process_thread_create (void (*eip) (void), void *func, void *arg);
+int process_thread_join (tid_t);
+void process_wait_threads (void);
+void process_set_dying (int status);
+void process_check_dying (void);
+bool process_is_dying (void);
+bool process_stack_contains (const void *uaddr);
+
 #endif /* userprog/process.h */
@@ -11,17 +11,20 @@
 #include "filesys/filesys.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "devices/input.h"
 #include "threads/synch.h"
+#include "userprog/futex.h"
 #include "vm/sup_page.h"
+#include "vm/page_cache.h"
 
-#define USER_STACK_BASE 0x08048000
 
 typedef int pid_t;
 
 static int global_fd = 1;       /* fd generator */
 struct list file_list;          /* List for storing all opened files */
-static uint32_t *stack_pointer; /* Functional stack pointer */
+static struct slab_cache file_des_cache;    /* File descriptors */
+struct slab_cache exit_code_cache;          /* Exit codes kept for parents */
 
 static void syscall_handler (struct intr_frame *);
 
@@ -30,7 +33,11 @@ syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
   lock_init(&file_lock);        /* Initialize file_lock */
+  lock_set_name(&file_lock, "file_lock");
   list_init(&file_list);        /* Initialize file list */
+  slab_cache_init(&file_des_cache, "file_des", sizeof(struct file_des), 0, NULL);
+  slab_cache_init(&exit_code_cache, "exit_code", sizeof(struct exit_code_list_element), 0, NULL);
+  futex_init();                 /* Initialize futex wait queues */
 }
 
 /* Bad pointer checker */
@@ -78,24 +85,28 @@ clear_files(struct thread* t)
     if(fdes->opener == t){
       list_remove(iter);
       file_close(fdes->file_ptr);
-      free(fdes);
+      slab_free(&file_des_cache, fdes);
     }
     iter = next_iter;
   }
   return;
 }
 
-/* Function foe condition check of stack growth */
+/* Function for condition check of stack growth: PTR must be in the
+   current thread's own stack region, at most 32 bytes below ESP */
 bool
-is_request_extra_stack(void* ptr)
+is_request_extra_stack(void* ptr, void* esp)
 {
-  return !(ptr < USER_STACK_BASE || (void*)stack_pointer - 32 > ptr);
+  return process_stack_contains(ptr) && ptr >= esp - 32;
 }
 
-/* Function for stack growing */
+/* Function for stack growing, the process's page_table_lock must
+   be held */
 bool
 grow_stack(void* ptr)
 {
+  ASSERT(lock_held_by_current_thread(&thread_current()->main_t->page_table_lock));
+
   bool success = false;
   struct frame* fe = frame_create(PAL_USER | PAL_ZERO);
   if(fe == NULL){
@@ -123,8 +134,8 @@ find_map_by_id(mapid_t mapping)
   struct thread* cur = thread_current();
   struct mmap_file_des* target = NULL;
 
-  for(struct list_elem* iter = list_begin(&cur->mmap_file_list);
-                        iter != list_end(&cur->mmap_file_list);
+  for(struct list_elem* iter = list_begin(&cur->main_t->mmap_file_list);
+                        iter != list_end(&cur->main_t->mmap_file_list);
                         iter = list_next(iter)){
     struct mmap_file_des* tmp = list_entry(iter, struct mmap_file_des, elem);
     if(tmp->id == mapping){
@@ -141,8 +152,7 @@ find_map_by_id(mapid_t mapping)
 static void
 syscall_handler (struct intr_frame *f) 
 {
-  stack_pointer = f->esp;
-  thread_current()->sp = stack_pointer;
+  thread_current()->sp = f->esp;
 
   /* Check the interrupt stack valid or not */
   if(bad_ptr(f->esp) || bad_ptr((int*)(f->esp) + 1)
@@ -153,7 +163,7 @@ syscall_handler (struct intr_frame *f)
   
   /* Check the interrupt code is valid or not */
   int intr_code = *(int*)(f->esp);
-  if(intr_code < SYS_HALT || intr_code > SYS_INUMBER){
+  if(intr_code < SYS_HALT || intr_code > SYS_MEMSTATS){
     exit(-1);
   }
   
@@ -288,6 +298,64 @@ syscall_handler (struct intr_frame *f)
       munmap(id);
       break;
     }
+
+    case SYS_LOCKSTATS:
+    {
+      lockstats();
+      break;
+    }
+
+    case SYS_MEMSTATS:
+    {
+      memstats();
+      break;
+    }
+
+    case SYS_FUTEX_WAIT:
+    {
+      /* parse the arguments first */
+      int* uaddr = (int*)*((int*)(f->esp) + 1);
+      int val = *((int*)(f->esp) + 2);
+
+      f->eax = futex_wait(uaddr, val);
+      break;
+    }
+
+    case SYS_FUTEX_WAKE:
+    {
+      /* parse the arguments first */
+      int* uaddr = (int*)*((int*)(f->esp) + 1);
+      int cnt = *((int*)(f->esp) + 2);
+
+      f->eax = futex_wake(uaddr, cnt);
+      break;
+    }
+
+    case SYS_THREAD_CREATE:
+    {
+      /* parse the arguments first */
+      void* eip = (void*)*((int*)(f->esp) + 1);
+      void* func = (void*)*((int*)(f->esp) + 2);
+      void* arg = (void*)*((int*)(f->esp) + 3);
+
+      f->eax = user_thread_create(eip, func, arg);
+      break;
+    }
+
+    case SYS_THREAD_JOIN:
+    {
+      /* parse the arguments first */
+      tid_t tid = *((int*)(f->esp) + 1);
+
+      f->eax = user_thread_join(tid);
+      break;
+    }
+
+    case SYS_THREAD_EXIT:
+    {
+      user_thread_exit();
+      break;
+    }
   }
 }
 
@@ -303,11 +371,20 @@ void
 exit(int status)
 {
   struct thread *cur = thread_current();
+
+  /* The whole process ends, with the status of its first exit() */
+  process_set_dying(status);
+  status = cur->main_t->exit_code;
   cur->exit_code = status;
 
+  /* The main thread reports it, the other threads end quietly */
+  if(cur->main_t != cur){
+    thread_exit();
+  }
+
   /* Construct a exit_code_element */
   if(cur->parent_t != NULL){
-    struct exit_code_list_element* exit_element = malloc(sizeof(struct exit_code_list_element));
+    struct exit_code_list_element* exit_element = slab_alloc(&exit_code_cache);
     exit_element->thread_tid = cur->tid;
     exit_element->thread_exit_code = status;
 
@@ -392,11 +469,11 @@ open(const char* file)
   struct file_des* des;
 
   if(file_opened != NULL){
-    des = (struct file_des*)malloc(sizeof(struct file_des));
+    des = slab_alloc(&file_des_cache);
     des->file_ptr = file_opened;
     des->fd = ++global_fd;                       /* Set the fd */
     des->size = file_length(file_opened);        /* Set the size of file */
-    des->opener = thread_current();              /* Set the opener thread */
+    des->opener = thread_current()->main_t;      /* Set the opener process */
     list_push_back(&file_list, &(des->filelem)); /* Push this descriptor into list */
 
     lock_release(&file_lock);
@@ -440,16 +517,20 @@ read(int fd, void *buffer, unsigned size)
         exit(-1);
       }
 
-      /* Check whether we need to load a fake page */
+      /* Check whether we need to load a fake page, holding the page
+         table lock from the lookup until the page is in */
+      struct lock* page_table_lock = &thread_current()->main_t->page_table_lock;
+      bool bad_ptr = false;
+      lock_acquire(page_table_lock);
       if(!pagedir_get_page(thread_current()->pagedir, ptr)){
         /* Check the file user request is a fake_pte or not */
-        struct supp_page* pte = find_fake_pte(&thread_current()->page_table, pg_round_down(ptr));
+        struct supp_page* pte = find_fake_pte(&thread_current()->main_t->page_table, pg_round_down(ptr));
         if(pte == NULL){                    /* If no supplemental information stored */
-          if(is_request_extra_stack(ptr)){
+          if(is_request_extra_stack(ptr, thread_current()->sp)){
             grow_stack(ptr);                /* Need to grow stack */
           }
           else{
-            exit(-1);
+            bad_ptr = true;
           }
         }
         else{                               /* If supplemental information exists */
@@ -457,10 +538,14 @@ read(int fd, void *buffer, unsigned size)
             fake2real_page_convert(pte);    /* Allocate space for this, lazy load */
           }
           else{                             /* Impossible real page but not found */
-            exit(-1);
+            bad_ptr = true;
           }
         }
       }
+      lock_release(page_table_lock);
+      if(bad_ptr){
+        exit(-1);
+      }
 
       size_copy -= PGSIZE;
       if(size_copy <= 0){
@@ -487,7 +572,9 @@ read(int fd, void *buffer, unsigned size)
   else if(fd == STDIN_FILENO){      /* If STDIN mode */
     void* ptr = buffer;
     while(!bad_ptr(ptr + 1) && (ptr - buffer) < size - 1){    /* check bad ptr or oversize */
-      *(uint8_t*)ptr = input_getc();
+      if(!input_getc_unless(process_is_dying, (uint8_t*)ptr)){ /* the process is dying, see process_set_dying() */
+        break;
+      }
       ptr ++;
     }
     *(uint8_t*)ptr = 0;                                       /* Fill the 0 at the end */
@@ -499,7 +586,10 @@ read(int fd, void *buffer, unsigned size)
       success =  -1;                /* return -1 */
     }
     else{
-      success = file_read(f->file_ptr, buffer, size);
+      /* Read through the page cache shared with mmap */
+      off_t pos = file_tell(f->file_ptr);
+      success = pcache_read(file_get_inode(f->file_ptr), buffer, size, pos);
+      file_seek(f->file_ptr, pos + success);
     }
   }
   lock_release(&file_lock);
@@ -533,7 +623,10 @@ write(int fd, const void *buffer, unsigned size)
       res = -1;                                 /* return -1 */
     }
     else{
+      /* Keep cached and mapped copies of the file up to date */
+      off_t pos = file_tell(f->file_ptr);
       res = file_write(f->file_ptr, buffer, size);
+      pcache_write(file_get_inode(f->file_ptr), buffer, res, pos);
     }
   }
 
@@ -600,12 +693,12 @@ close(int fd)
   struct file_des *f = find_des_by_fd(fd);    /* Find the target file descriptor */
 
   /* Check the file is valid or not and check the closer is also the opener or not */
-  if(f == NULL || f->opener != thread_current()){
+  if(f == NULL || f->opener != thread_current()->main_t){
     goto done;
   }
   list_remove(&(f->filelem));
   file_close(f->file_ptr);
-  free(f);
+  slab_free(&file_des_cache, f);
 
 done:
   lock_release(&file_lock);
@@ -640,48 +733,35 @@ mmap(int fd, void *addr)
   }
   ASSERT(length == file_length(file_copy));
 
-  /* Check whether overlapping mapped memory exists */
-  for(int advance = 0; advance < length; advance += PGSIZE){
-    if(find_fake_pte(&thread_current()->page_table, pg_round_down(addr + advance))){
-      goto done;
-    }
+  /* Check whether overlapping mapped memory exists, and reserve the
+     range under the same hold of the page table lock */
+  struct lock* page_table_lock = &thread_current()->main_t->page_table_lock;
+  lock_acquire(page_table_lock);
+  size_t key = pg_no(addr);
+  if(radix_next(&thread_current()->main_t->page_table, &key, pg_no(addr + length - 1)) != NULL){
+    lock_release(page_table_lock);
+    goto done;
   }
 
-  uint32_t zero_bytes;
-  uint32_t read_bytes;
-  if(length <= PGSIZE){
-    read_bytes = length;
-    zero_bytes = PGSIZE - read_bytes;
-    if(!supp_page_entry_create(LAZY_LOAD, file_copy, 0, addr, read_bytes, zero_bytes, true)){
-      goto done;
-    }
-  }
-  else{
-    zero_bytes = (uint32_t)length % (uint32_t)PGSIZE;
-    read_bytes = (uint32_t)length - (uint32_t)zero_bytes;
-   
-    /* Lazy load */
-    int i = 0;
-    for(i = 0; i < read_bytes / PGSIZE; i++){
-      if(!supp_page_entry_create(LAZY_LOAD, file_copy, i * PGSIZE, addr + i * PGSIZE,
-                                  PGSIZE, 0, true)){
-        goto done;
-      }
-    }
-    if(!supp_page_entry_create(LAZY_LOAD, file_copy, i * PGSIZE, addr + i * PGSIZE,
-                                  PGSIZE - zero_bytes, zero_bytes, true)){
+  /* Lazy load, every page is shared through the page cache */
+  for(int advance = 0; advance < length; advance += PGSIZE){
+    uint32_t read_bytes = length - advance < PGSIZE ? length - advance : PGSIZE;
+    if(!supp_page_entry_create(FILE_MAPPED, file_copy, advance, addr + advance,
+                                read_bytes, PGSIZE - read_bytes, true)){
+      lock_release(page_table_lock);
       goto done;
     }
   }
+  lock_release(page_table_lock);
 
   /* Generate a mapid */
-  id = list_size(&thread_current()->mmap_file_list);
+  id = list_size(&thread_current()->main_t->mmap_file_list);
   struct mmap_file_des* mf_des = malloc(sizeof(struct mmap_file_des));
   mf_des->id = id;
   mf_des->file_ptr = file_copy;
   mf_des->mapped_addr = addr;
   mf_des->length = length;
-  list_push_back(&thread_current()->mmap_file_list, &mf_des->elem);
+  list_push_back(&thread_current()->main_t->mmap_file_list, &mf_des->elem);
 
 done:
   lock_release(&file_lock);
@@ -707,18 +787,27 @@ munmap (mapid_t mapping)
   ASSERT(pg_round_down(start_ptr) == start_ptr);
 
   lock_acquire(&file_lock);
+  struct lock* page_table_lock = &thread_current()->main_t->page_table_lock;
+  lock_acquire(page_table_lock);
   
-  for(int advance = 0; advance < length; advance += PGSIZE){
-    struct supp_page* spge = find_fake_pte(&thread_current()->page_table, start_ptr + advance);
+  size_t key = pg_no(start_ptr);
+  struct supp_page* spge;
+  while((spge = radix_next(&thread_current()->main_t->page_table, &key,
+                           pg_no(start_ptr + length - 1))) != NULL){
+    int advance = (uint8_t*)spge->user_vaddr - (uint8_t*)start_ptr;
+    key ++;
     int write_length = PGSIZE;
     if(advance + PGSIZE > length){
       write_length = length - advance;
     }
     if(!try_to_unmap(spge, advance, write_length)){  /* Try to unmap this spge */
+      lock_release(page_table_lock);
+      lock_release(&file_lock);
       exit(-1);
     }  
-    free(spge);                       /* Free the supplemental page table entry*/
+    supp_page_free(spge);             /* Free the supplemental page table entry*/
   }
+  lock_release(page_table_lock);
   
   /* Close the file and clear the memory mapped file descriptor */
   file_close(mf_des->file_ptr);
@@ -729,4 +818,94 @@ munmap (mapid_t mapping)
   free(mf_des);
 
   return;
-}
\ No newline at end of file
+}
+
+/* syscall: print contention statistics of the profiled kernel locks */
+void
+lockstats(void)
+{
+  lock_print_stats();
+  return;
+}
+
+/* syscall: print how kernel memory is used, by pool, allocation
+   tag, malloc() and slab cache */
+void
+memstats(void)
+{
+  palloc_print_stats();
+  malloc_print_stats();
+  slab_print_stats();
+  return;
+}
+
+/* syscall: sleep while *UADDR holds VAL, until futex_wake().
+   Returns 0 once woken, -1 if *UADDR did not hold VAL */
+int
+futex_wait(int* uaddr, int val)
+{
+  /* Check the word is valid and aligned */
+  if(uaddr == NULL || !is_user_vaddr(uaddr) || (uintptr_t)uaddr % sizeof(int) != 0){
+    exit(-1);
+  }
+
+  enum futex_result result;
+  do{
+    /* Touch the word without any lock held, so that a page fault
+       loads it here, or kills the process here if it is not a
+       user page at all.  It may be evicted again before the check */
+    (void)*(volatile int*)uaddr;
+    result = futex_queue_wait(thread_current()->pagedir, uaddr, val);
+  }while(result == FUTEX_NOT_PRESENT);
+
+  return result == FUTEX_WOKEN ? 0 : -1;
+}
+
+/* syscall: wake up to CNT threads sleeping on UADDR.
+   Returns the number of threads woken */
+int
+futex_wake(int* uaddr, int cnt)
+{
+  /* UADDR is only a key here, it is never read */
+  if(uaddr == NULL || !is_user_vaddr(uaddr) || (uintptr_t)uaddr % sizeof(int) != 0){
+    exit(-1);
+  }
+
+  return futex_queue_wake(thread_current()->pagedir, uaddr, cnt);
+}
+
+/* syscall: start a thread in this process running EIP in user
+   mode, called with FUNC and ARG, on a stack of its own.  Returns
+   its tid, or -1 if it cannot be created */
+tid_t
+user_thread_create(void* eip, void* func, void* arg)
+{
+  /* A bad FUNC or ARG only hurts the new thread, but EIP must at
+     least be a user address */
+  if(eip == NULL || !is_user_vaddr(eip)){
+    exit(-1);
+  }
+  return process_thread_create((void (*) (void))eip, func, arg);
+}
+
+/* syscall: wait for thread TID of this process to exit.
+   Returns 0 once it has, -1 if TID cannot be joined */
+int
+user_thread_join(tid_t tid)
+{
+  return process_thread_join(tid);
+}
+
+/* syscall: end the calling thread.  For the main thread this
+   ends the process with status 0, after the other threads */
+void
+user_thread_exit(void)
+{
+  struct thread* cur = thread_current();
+
+  if(cur->main_t != cur){
+    thread_exit();
+  }
+  process_wait_threads();
+  exit(0);
+}
@@ -1,11 +1,14 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include "threads/thread.h"
+#include "threads/slab.h"
 #include "vm/frame.h"
 #include "vm/sup_page.h"
 
 typedef int pid_t;
 
+extern struct slab_cache exit_code_cache;   /* Exit codes kept for parents */
+
 struct lock file_lock;          /* Lock for file operations */
 
 /* File descriptor */
@@ -14,7 +17,7 @@ struct file_des
   int fd;                             /* File descriptor number */
   int size;                           /* Size of this file */
   struct file *file_ptr;              /* The pointer of this file */
-  struct thread* opener;              /* The thread open this file */
+  struct thread* opener;              /* Main thread of the process open this file */
   struct list_elem filelem;           /* Element for list */
 };
 
@@ -37,11 +40,18 @@ void close(int fd);
 
 mapid_t mmap(int fd, void *addr);
 void munmap (mapid_t mapping);
+void lockstats(void);
+void memstats(void);
+int futex_wait(int* uaddr, int val);
+int futex_wake(int* uaddr, int cnt);
+tid_t user_thread_create(void* eip, void* func, void* arg);
+int user_thread_join(tid_t tid);
+void user_thread_exit(void);
 
 /* Helper functions */
 int bad_ptr(const char* file);
 void clear_files(struct thread* t);
-bool is_request_extra_stack(void* ptr);
+bool is_request_extra_stack(void* ptr, void* esp);
 bool grow_stack(void* ptr);
 struct mmap_file_des* find_map_by_id(mapid_t mapping);
 
@@ -2,21 +2,31 @@
 #include <stdio.h>
 #include <string.h>
 #include "lib/kernel/list.h"
+#include "lib/kernel/radix.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "devices/timer.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
 #include "vm/sup_page.h"
+#include "vm/page_cache.h"
 
-#define LATEST_CREATE_TIME 0xefffffff
+static struct slab_cache frame_cache;   /* Frame table entries */
+static struct radix_tree frame_map;     /* Frames by page number of their kernel page */
+
+static void destroy_frame(struct frame* f);
+static bool lock_page_table_of(struct frame* f);
 
 void
 initialize_frame_table(void)
 {
   list_init(&frame_table);
-  lock_init(&frame_lock);
+  radix_init(&frame_map);
+  rwlock_init(&frame_lock);
+  rwlock_set_name(&frame_lock, "frame_lock");
+  slab_cache_init(&frame_cache, "frame", sizeof(struct frame), 0, NULL);
   return;
 }
 
@@ -31,7 +41,7 @@ frame_init(struct frame* f, enum palloc_flags flag)
   }
 
   /* Initialize frame elements */
-  f->allocator = thread_current();
+  f->allocator = thread_current()->main_t;    /* Owner of the page table */
   f->pte = NULL;
   f->created_time = timer_ticks();
   f->locked = true;
@@ -41,11 +51,8 @@ frame_init(struct frame* f, enum palloc_flags flag)
   f->frame_base = frame_base;
   
   if(frame_base == NULL){                     /* No more page can be allocated from memory */
-    /* Need to do eviction */
-    struct frame* victim_frame = next_frame_to_evict();    
-    size_t swap_idx = write_into_swap_space(victim_frame->user_vaddr);
-    
-    success = try_to_evict(victim_frame, swap_idx);
+    /* Drop an unused page cache page, or do eviction if there is none */
+    success = pcache_reclaim() || evict_one_frame();
     if(success){
       /* alloc a new frame here. */
       frame_base = frame_allocation(flag);
@@ -65,7 +72,7 @@ struct frame*
 frame_create(enum palloc_flags flag)
 {
   /* Allocate space */
-  struct frame* f = (struct frame*) malloc(sizeof(struct frame));
+  struct frame* f = slab_alloc(&frame_cache);
   if(f == NULL){
     goto done;
   }
@@ -78,10 +85,16 @@ frame_create(enum palloc_flags flag)
   }
   
   /* push the new frame into the frame table */
-  lock_acquire(&frame_lock);
+  rwlock_acquire_write(&frame_lock);
+  if(!radix_insert(&frame_map, pg_no(f->frame_base), f)){  /* Out of memory for the index */
+    rwlock_release_write(&frame_lock);
+    palloc_free_page(f->frame_base);
+    slab_free(&frame_cache, f);
+    return NULL;
+  }
   list_push_back(&frame_table, &f->elem);
   f->locked = false;
-  lock_release(&frame_lock);
+  rwlock_release_write(&frame_lock);
 
 done:
   return f;
@@ -91,7 +104,7 @@ uint8_t*
 frame_allocation(enum palloc_flags flag)
 {
   /* Synchronization: only one process can allocate a frame at the same time */
-  lock_acquire(&frame_lock);
+  rwlock_acquire_write(&frame_lock);
 
   uint8_t* frame_base = NULL;
   if(flag == PAL_USER | PAL_ZERO){
@@ -103,7 +116,7 @@ frame_allocation(enum palloc_flags flag)
     }
   }
 
-  lock_release(&frame_lock);
+  rwlock_release_write(&frame_lock);
   return frame_base;
 }
 
@@ -117,81 +130,148 @@ free_frame(struct frame* f)
     goto done;
   }
 
-  /* Free the frame allocated before */
+  /* Remove this frame table entry */
+  rwlock_acquire_write(&frame_lock);
+  list_remove(&f->elem);
   if(f->frame_base != NULL){
-    palloc_free_page (f->frame_base);
+    radix_delete(&frame_map, pg_no(f->frame_base));
   }
+  rwlock_release_write(&frame_lock);
 
-  /* Remove and free this frame table entry */
-  lock_acquire(&frame_lock);
-  list_remove(&f->elem);
-  lock_release(&frame_lock);
-  
-  free(f);
-
+  destroy_frame(f);
   success = true;
 
 done:
   return success;
 }
 
+/* Free the frame of kernel page KPAGE.  Returns false if KPAGE is
+   not a frame, e.g. a page cache page, or is being evicted */
+bool
+free_frame_of_page(uint8_t* kpage)
+{
+  /* Synchronization: find and remove the entry under one hold of the
+     lock, so that an eviction cannot free it in between */
+  rwlock_acquire_write(&frame_lock);
+  struct frame* f = radix_delete(&frame_map, pg_no(kpage));
+  if(f != NULL){
+    list_remove(&f->elem);
+  }
+  rwlock_release_write(&frame_lock);
+
+  if(f == NULL){
+    return false;
+  }
+  destroy_frame(f);
+  return true;
+}
+
+/* Find the frame of kernel page F, or NULL if F is not a frame,
+   e.g. a page cache page, or is being evicted.  The frame may be
+   evicted or freed as soon as this returns, so only use the result
+   while the frame is locked */
 struct frame*
 find_frame_table_entry_by_frame(uint8_t* f)
 {
-  /* Synchronization: ensure the whole finding is atomic */
-  struct frame* fe = NULL;
-  for(struct list_elem* iter = list_begin(&frame_table);
-                        iter != list_end(&frame_table);
-                        iter = list_next(iter)){
-    fe = list_entry(iter, struct frame, elem);
-    if(fe->frame_base == f){
-      return fe;
-    }
-  }
-  return fe;
+  /* Synchronization: lookups may run together */
+  rwlock_acquire_read(&frame_lock);
+  struct frame* found = radix_lookup(&frame_map, pg_no(f));
+  rwlock_release_read(&frame_lock);
+  return found;
 }
 
 void
 set_pte_to_given_frame(uint8_t* frame_base, uint32_t* pte, void* user_ptr)
 {
-  struct frame* fe = find_frame_table_entry_by_frame(frame_base);
-  if(!fe){
-    return;
+  /* Synchronization: hold the lock while writing, so that the frame
+     cannot be evicted and freed under us */
+  rwlock_acquire_read(&frame_lock);
+  struct frame* fe = radix_lookup(&frame_map, pg_no(frame_base));
+  if(fe != NULL){
+    fe->pte = pte;
+    fe->user_vaddr = user_ptr;
   }
-  fe->pte = pte;
-  fe->user_vaddr = user_ptr;
+  rwlock_release_read(&frame_lock);
   return;
 }
 
-/* Use LRC(Least Recently Created) mechanism to evict */
+/* Give back the page of frame F, which is in no table any more, and
+   F itself */
+static void
+destroy_frame(struct frame* f)
+{
+  if(f->frame_base != NULL){
+    palloc_free_page(f->frame_base);
+  }
+  slab_free(&frame_cache, f);
+}
+
+/* Lock the supplemental page table of frame F's process for
+   evicting F, without waiting: its holder may be waiting for a
+   frame itself.  Returns false if another thread holds it */
+static bool
+lock_page_table_of(struct frame* f)
+{
+  struct lock* page_table_lock = &f->allocator->page_table_lock;
+  return lock_held_by_current_thread(page_table_lock)
+         || lock_try_acquire(page_table_lock);
+}
+
+/* Use LRC(Least Recently Created) mechanism to evict.  The victim's
+   supplemental page table is returned locked */
 struct frame*
 next_frame_to_evict(void)
 {
   /* Synchronization: ensure the choose operation and lock frame operation is atomic */
-  lock_acquire(&frame_lock);
+  rwlock_acquire_write(&frame_lock);
 
-  unsigned create_time = LATEST_CREATE_TIME;
   struct frame* target_fe = NULL;
 
+  /* Frames are appended as they are created, so the first one that
+     can be locked is the least recently created */
   for(struct list_elem* iter = list_begin(&frame_table);
                         iter != list_end(&frame_table);
                         iter = list_next(iter)){
     struct frame* fe = list_entry(iter, struct frame, elem);
-    if(fe->created_time < create_time && !fe->locked){
+    if(!fe->locked && lock_page_table_of(fe)){
       target_fe = fe;
-      create_time = fe->created_time;
+      break;
     }
   }
 
   if(target_fe != NULL){
     list_remove(&target_fe->elem);
+    radix_delete(&frame_map, pg_no(target_fe->frame_base));
     target_fe->locked = true;
   }
 
-  lock_release(&frame_lock);
+  rwlock_release_write(&frame_lock);
   return target_fe;
 }
 
+/* Evict the next victim frame into swap space.
+   Returns false if every frame is locked */
+bool
+evict_one_frame(void)
+{
+  /* A thread loading a page of its own process holds its page
+     table lock already, and keeps it */
+  struct lock* own_lock = &thread_current()->main_t->page_table_lock;
+  bool own_held = lock_held_by_current_thread(own_lock);
+
+  struct frame* victim_frame = next_frame_to_evict();
+  if(victim_frame == NULL){
+    return false;
+  }
+  struct lock* victim_lock = &victim_frame->allocator->page_table_lock;
+  size_t swap_idx = write_into_swap_space(victim_frame->user_vaddr);
+  bool success = try_to_evict(victim_frame, swap_idx);
+  if(victim_lock != own_lock || !own_held){
+    lock_release(victim_lock);
+  }
+  return success;
+}
+
 bool
 try_to_evict(struct frame* f, size_t swap_idx)
 {
@@ -221,7 +301,7 @@ try_to_evict(struct frame* f, size_t swap_idx)
 
   pagedir_clear_page(allocator_t->pagedir, f->user_vaddr);
   palloc_free_page(f->frame_base);
-  free(f);
+  slab_free(&frame_cache, f);
   success = true;
 
 done:
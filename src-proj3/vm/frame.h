@@ -7,9 +7,11 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 
-/* Frame table, every entry is a frame */
+/* Frame table, every entry is a frame.  frame_lock serializes
+   changes; lookups by kernel page go through an index and take it
+   shared */
 struct list frame_table;
-struct lock frame_lock;
+struct rwlock frame_lock;
 
 /* Frame */
 struct frame{
@@ -30,11 +32,13 @@ bool frame_init(struct frame* f, enum palloc_flags flag);
 struct frame* frame_create(enum palloc_flags flag);
 uint8_t* frame_allocation(enum palloc_flags flag);
 bool free_frame(struct frame* f);
+bool free_frame_of_page(uint8_t* kpage);
 
 /* Functionality needed by other parts */
 struct frame* find_frame_table_entry_by_frame(uint8_t* f);
 void set_pte_to_given_frame(uint8_t* frame_base, uint32_t* pte, void* user_ptr);
 struct frame* next_frame_to_evict(void);
+bool evict_one_frame(void);
 bool try_to_evict(struct frame* f, size_t swap_idx);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,476 @@
+#include <debug.h>
+#include <string.h>
+#include "vm/page_cache.h"
+#include "vm/frame.h"
+#include "vm/sup_page.h"
+#include "userprog/pagedir.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Page cache: every page of file data read() or mmap() touched,
+   keyed by (inode, page offset).  All mappings of a page map the
+   same kernel page, so the data is neither copied per process nor
+   copied again on the way to or from the user.
+
+   A page is pinned while it is being loaded or copied, and only
+   unpinned pages are dropped.  A mapped page is dropped too when
+   memory runs out: it is unmapped from every process first, and
+   faults back in through the cache.  A page written through a
+   mapping is written back when its last user lets go of it, so
+   pages without users are always clean. */
+static struct hash pcache_table;    /* All cached pages */
+static struct list pcache_lru;      /* All cached pages, least recently used first */
+static size_t pcache_cnt;           /* Number of cached pages */
+
+/* Synchronization variables for page cache */
+static struct lock pcache_lock;
+static struct condition pcache_loaded;  /* A page finished loading */
+
+static unsigned pcache_hash(const struct hash_elem* e, void* aux UNUSED);
+static bool pcache_less(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED);
+static struct pcache_page* pcache_lookup(struct inode* inode, off_t ofs);
+static struct pcache_page* pcache_get(struct inode* inode, off_t ofs);
+static void pcache_put(struct pcache_page* p, bool dirty);
+static void pcache_wait_loaded(struct pcache_page* p);
+static void pcache_settle(struct pcache_page* p);
+static uint8_t* pcache_get_page(void);
+static bool pcache_drop_lru(bool mapped);
+static bool pcache_unmap_all(struct pcache_page* p);
+static void pcache_drop(struct pcache_page* p);
+
+/* Initialize the page cache, should be used after initialize_frame_table() */
+void
+pcache_init(void)
+{
+  hash_init(&pcache_table, pcache_hash, pcache_less, NULL);
+  list_init(&pcache_lru);
+  lock_init(&pcache_lock);
+  lock_set_name(&pcache_lock, "pcache_lock");
+  cond_init(&pcache_loaded);
+  pcache_cnt = 0;
+  return;
+}
+
+/* Return the kernel address of the page of INODE at OFS, loading
+   it if needed, and record that the current process maps it at
+   UPAGE.  The process's page_table_lock must be held until UPAGE
+   maps the page, see pcache_unmap_all().  Returns NULL if memory
+   is exhausted. */
+uint8_t*
+pcache_map(struct inode* inode, off_t ofs, void* upage)
+{
+  struct thread* owner = thread_current()->main_t;
+  ASSERT(lock_held_by_current_thread(&owner->page_table_lock));
+
+  struct pcache_mapping* m = malloc(sizeof(struct pcache_mapping));
+  if(m == NULL){
+    return NULL;
+  }
+  struct pcache_page* p = pcache_get(inode, ofs);
+  if(p == NULL){
+    free(m);
+    return NULL;
+  }
+
+  m->owner = owner;
+  m->upage = upage;
+  m->table_locked = false;
+  lock_acquire(&pcache_lock);
+  list_push_back(&p->mappings, &m->elem);
+  p->pin_cnt --;            /* The mapping keeps it cached from now on */
+  lock_release(&pcache_lock);
+  return p->kpage;
+}
+
+/* Drop the mapping at UPAGE of the current process of the page of
+   INODE at OFS, made by pcache_map().  DIRTY tells whether the
+   mapping wrote to the page */
+void
+pcache_unmap(struct inode* inode, off_t ofs, void* upage, bool dirty)
+{
+  struct thread* owner = thread_current()->main_t;
+  struct pcache_mapping* m = NULL;
+
+  lock_acquire(&pcache_lock);
+  struct pcache_page* p = pcache_lookup(inode, ofs);
+  ASSERT(p != NULL);        /* A mapped page is kept, so it must be there */
+  for(struct list_elem* iter = list_begin(&p->mappings);
+                        iter != list_end(&p->mappings);
+                        iter = list_next(iter)){
+    struct pcache_mapping* tmp = list_entry(iter, struct pcache_mapping, elem);
+    if(tmp->owner == owner && tmp->upage == upage){
+      m = tmp;
+      break;
+    }
+  }
+  ASSERT(m != NULL);
+  list_remove(&m->elem);
+  p->dirty = p->dirty || dirty;
+  pcache_settle(p);
+  lock_release(&pcache_lock);
+
+  free(m);
+  return;
+}
+
+/* Read SIZE bytes of INODE starting at OFS into BUFFER through the
+   page cache.  Returns the number of bytes actually read */
+off_t
+pcache_read(struct inode* inode, void* buffer_, off_t size, off_t ofs)
+{
+  uint8_t* buffer = buffer_;
+  off_t bytes_read = 0;
+
+  while(size > 0){
+    off_t page_ofs = ofs % PGSIZE;
+    off_t inode_left = inode_length(inode) - ofs;
+    off_t chunk = PGSIZE - page_ofs;
+    if(chunk > size){
+      chunk = size;
+    }
+    if(chunk > inode_left){
+      chunk = inode_left;
+    }
+    if(chunk <= 0){
+      break;
+    }
+
+    struct pcache_page* p = pcache_get(inode, ofs - page_ofs);
+    if(p == NULL){          /* Out of memory, read the rest around the cache */
+      bytes_read += inode_read_at(inode, buffer + bytes_read, size, ofs);
+      break;
+    }
+    memcpy(buffer + bytes_read, p->kpage + page_ofs, chunk);
+    pcache_put(p, false);
+
+    size -= chunk;
+    ofs += chunk;
+    bytes_read += chunk;
+  }
+  return bytes_read;
+}
+
+/* Bring cached pages of INODE up to date with SIZE bytes of BUFFER
+   just written at OFS, so that mappings see the new data */
+void
+pcache_write(struct inode* inode, const void* buffer_, off_t size, off_t ofs)
+{
+  const uint8_t* buffer = buffer_;
+
+  while(size > 0){
+    off_t page_ofs = ofs % PGSIZE;
+    off_t chunk = PGSIZE - page_ofs;
+    if(chunk > size){
+      chunk = size;
+    }
+
+    lock_acquire(&pcache_lock);
+    struct pcache_page* p = pcache_lookup(inode, ofs - page_ofs);
+    if(p != NULL){
+      p->pin_cnt ++;
+      pcache_wait_loaded(p);  /* Its load may have read the old data */
+    }
+    lock_release(&pcache_lock);
+
+    /* Copy without the lock, BUFFER may fault */
+    if(p != NULL){
+      memcpy(p->kpage + page_ofs, buffer, chunk);
+      pcache_put(p, false);
+    }
+
+    size -= chunk;
+    ofs += chunk;
+    buffer += chunk;
+  }
+  return;
+}
+
+/* Drop every cached page of INODE, used by inode_close() when the
+   last opener goes away */
+void
+pcache_inode_close(struct inode* inode)
+{
+  lock_acquire(&pcache_lock);
+  struct list_elem* iter = list_begin(&pcache_lru);
+  while(iter != list_end(&pcache_lru)){
+    struct pcache_page* p = list_entry(iter, struct pcache_page, lru_elem);
+    iter = list_next(iter);
+    if(p->inode == inode){
+      ASSERT(p->pin_cnt == 0 && list_empty(&p->mappings));
+      pcache_drop(p);
+    }
+  }
+  lock_release(&pcache_lock);
+  return;
+}
+
+/* Drop the least recently used unpinned page to free memory,
+   preferring pages nobody maps.  Returns false if every cached
+   page is in use */
+bool
+pcache_reclaim(void)
+{
+  lock_acquire(&pcache_lock);
+  bool success = pcache_drop_lru(false) || pcache_drop_lru(true);
+  lock_release(&pcache_lock);
+  return success;
+}
+
+static unsigned
+pcache_hash(const struct hash_elem* e, void* aux UNUSED)
+{
+  const struct pcache_page* p = hash_entry(e, struct pcache_page, h_elem);
+  return hash_bytes(&p->inode, sizeof p->inode) ^ hash_int(p->ofs);
+}
+
+static bool
+pcache_less(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED)
+{
+  const struct pcache_page* p_a = hash_entry(a, struct pcache_page, h_elem);
+  const struct pcache_page* p_b = hash_entry(b, struct pcache_page, h_elem);
+  if(p_a->inode != p_b->inode){
+    return p_a->inode < p_b->inode;
+  }
+  return p_a->ofs < p_b->ofs;
+}
+
+/* Find the cached page of INODE at OFS, or NULL */
+static struct pcache_page*
+pcache_lookup(struct inode* inode, off_t ofs)
+{
+  ASSERT(lock_held_by_current_thread(&pcache_lock));
+
+  struct pcache_page key;
+  key.inode = inode;
+  key.ofs = ofs;
+  struct hash_elem* he = hash_find(&pcache_table, &key.h_elem);
+  return he == NULL ? NULL : hash_entry(he, struct pcache_page, h_elem);
+}
+
+/* Find or load the page of INODE at OFS and pin it.
+   Returns NULL if memory is exhausted */
+static struct pcache_page*
+pcache_get(struct inode* inode, off_t ofs)
+{
+  ASSERT(ofs % PGSIZE == 0);
+
+  lock_acquire(&pcache_lock);
+  struct pcache_page* p = pcache_lookup(inode, ofs);
+  if(p != NULL){
+    goto done;
+  }
+  lock_release(&pcache_lock);
+
+  /* Miss: allocate without the lock, making room may evict a frame */
+  uint8_t* kpage = pcache_get_page();
+  p = malloc(sizeof(struct pcache_page));
+  if(kpage == NULL || p == NULL){
+    if(kpage != NULL){
+      palloc_free_page(kpage);
+    }
+    free(p);
+    return NULL;
+  }
+
+  lock_acquire(&pcache_lock);
+  struct pcache_page* raced = pcache_lookup(inode, ofs);
+  if(raced != NULL){        /* Someone else loaded it meanwhile */
+    palloc_free_page(kpage);
+    free(p);
+    p = raced;
+    goto done;
+  }
+
+  /* Publish the page as loading, then read without the lock so
+     that other pages are served meanwhile.  Users of this page
+     wait for the read, and a write() that lands in between either
+     reaches the disk before it or waits for it, see pcache_write() */
+  p->inode = inode;
+  p->ofs = ofs;
+  p->kpage = kpage;
+  p->pin_cnt = 1;
+  p->loading = true;
+  p->dirty = false;
+  list_init(&p->mappings);
+  hash_insert(&pcache_table, &p->h_elem);
+  list_push_back(&pcache_lru, &p->lru_elem);
+  pcache_cnt ++;
+  lock_release(&pcache_lock);
+
+  off_t read_bytes = inode_read_at(inode, kpage, PGSIZE, ofs);
+  memset(kpage + read_bytes, 0, PGSIZE - read_bytes);
+
+  lock_acquire(&pcache_lock);
+  p->loading = false;
+  cond_broadcast(&pcache_loaded, &pcache_lock);
+  lock_release(&pcache_lock);
+  return p;
+
+done:
+  p->pin_cnt ++;
+  list_remove(&p->lru_elem);                /* Most recently used now */
+  list_push_back(&pcache_lru, &p->lru_elem);
+  pcache_wait_loaded(p);
+  lock_release(&pcache_lock);
+  return p;
+}
+
+/* Unpin P.  DIRTY tells whether the user wrote to the page; the
+   last user writes a dirty page back */
+static void
+pcache_put(struct pcache_page* p, bool dirty)
+{
+  lock_acquire(&pcache_lock);
+  ASSERT(p->pin_cnt > 0);
+
+  p->dirty = p->dirty || dirty;
+  p->pin_cnt --;
+  pcache_settle(p);
+  lock_release(&pcache_lock);
+  return;
+}
+
+/* Wait until P, which the caller has pinned, is loaded */
+static void
+pcache_wait_loaded(struct pcache_page* p)
+{
+  ASSERT(lock_held_by_current_thread(&pcache_lock));
+  ASSERT(p->pin_cnt > 0);
+
+  while(p->loading){
+    cond_wait(&pcache_loaded, &pcache_lock);
+  }
+  return;
+}
+
+/* Write P back if it is dirty and has no user left */
+static void
+pcache_settle(struct pcache_page* p)
+{
+  ASSERT(lock_held_by_current_thread(&pcache_lock));
+
+  if(p->pin_cnt == 0 && list_empty(&p->mappings) && p->dirty){
+    off_t write_bytes = inode_length(p->inode) - p->ofs;
+    if(write_bytes > PGSIZE){
+      write_bytes = PGSIZE;
+    }
+    if(write_bytes > 0){
+      inode_write_at(p->inode, p->kpage, write_bytes, p->ofs);
+    }
+    p->dirty = false;
+  }
+  return;
+}
+
+/* Get a user page for the cache, dropping an old cached page or
+   evicting a frame if the user pool is exhausted */
+static uint8_t*
+pcache_get_page(void)
+{
+  if(pcache_cnt >= PCACHE_PAGES){
+    lock_acquire(&pcache_lock);
+    pcache_drop_lru(false);
+    lock_release(&pcache_lock);
+  }
+
+  uint8_t* kpage = palloc_get_page(PAL_USER | PAL_TAG(PAL_TAG_CACHE));
+  while(kpage == NULL){
+    if(!pcache_reclaim() && !evict_one_frame()){
+      break;
+    }
+    kpage = palloc_get_page(PAL_USER | PAL_TAG(PAL_TAG_CACHE));
+  }
+  return kpage;
+}
+
+/* Drop the least recently used unpinned page, unmapping it first
+   if it is mapped and MAPPED is true.  Returns false if there is
+   no such page */
+static bool
+pcache_drop_lru(bool mapped)
+{
+  ASSERT(lock_held_by_current_thread(&pcache_lock));
+
+  for(struct list_elem* iter = list_begin(&pcache_lru);
+                        iter != list_end(&pcache_lru);
+                        iter = list_next(iter)){
+    struct pcache_page* p = list_entry(iter, struct pcache_page, lru_elem);
+    if(p->pin_cnt > 0){
+      continue;
+    }
+    if(!list_empty(&p->mappings) && (!mapped || !pcache_unmap_all(p))){
+      continue;
+    }
+    pcache_settle(p);
+    pcache_drop(p);
+    return true;
+  }
+  return false;
+}
+
+/* Unmap P from every process that maps it, so that their next
+   access faults it back in through the cache.  Like eviction, it
+   never waits for a page table lock, since the holder may be
+   waiting for memory itself; a holder may also be mapping P right
+   now.  Returns false, changing nothing, if a lock is taken */
+static bool
+pcache_unmap_all(struct pcache_page* p)
+{
+  ASSERT(lock_held_by_current_thread(&pcache_lock));
+
+  /* Lock the page table of every mapper first */
+  bool success = true;
+  for(struct list_elem* iter = list_begin(&p->mappings);
+                        iter != list_end(&p->mappings);
+                        iter = list_next(iter)){
+    struct pcache_mapping* m = list_entry(iter, struct pcache_mapping, elem);
+    struct lock* page_table_lock = &m->owner->page_table_lock;
+    if(lock_held_by_current_thread(page_table_lock)){
+      continue;
+    }
+    if(!lock_try_acquire(page_table_lock)){
+      success = false;
+      break;
+    }
+    m->table_locked = true;
+  }
+
+  struct list_elem* iter = list_begin(&p->mappings);
+  while(iter != list_end(&p->mappings)){
+    struct pcache_mapping* m = list_entry(iter, struct pcache_mapping, elem);
+    iter = list_next(iter);
+    if(success){
+      struct supp_page* spge = find_fake_pte(&m->owner->page_table, m->upage);
+      ASSERT(spge != NULL && spge->type == FILE_MAPPED && !spge->fake_page);
+      p->dirty = p->dirty || pagedir_is_dirty(m->owner->pagedir, m->upage);
+      pagedir_clear_page(m->owner->pagedir, m->upage);
+      spge->fake_page = true;
+      list_remove(&m->elem);
+    }
+    if(m->table_locked){
+      m->table_locked = false;
+      lock_release(&m->owner->page_table_lock);
+    }
+    if(success){
+      free(m);
+    }
+  }
+  return success;
+}
+
+/* Remove P from the cache and free it */
+static void
+pcache_drop(struct pcache_page* p)
+{
+  ASSERT(lock_held_by_current_thread(&pcache_lock));
+  ASSERT(p->pin_cnt == 0 && list_empty(&p->mappings) && !p->dirty);
+
+  hash_delete(&pcache_table, &p->h_elem);
+  list_remove(&p->lru_elem);
+  palloc_free_page(p->kpage);
+  free(p);
+  pcache_cnt --;
+  return;
+}
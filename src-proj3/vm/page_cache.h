@@ -0,0 +1,50 @@
+#ifndef VM_PAGE_CACHE_H
+#define VM_PAGE_CACHE_H
+
+#include <stdbool.h>
+#include "lib/kernel/hash.h"
+#include "lib/kernel/list.h"
+#include "filesys/inode.h"
+#include "filesys/off_t.h"
+
+/* Pages kept cached without any user before the least recently
+   used one is dropped */
+#define PCACHE_PAGES 64
+
+/* A user page mapping a page cache page */
+struct pcache_mapping{
+  struct thread* owner;         /* Main thread of the mapping process */
+  void* upage;                  /* User virtual address of the mapping */
+  bool table_locked;            /* Owner's page table locked to unmap it */
+  struct list_elem elem;        /* Element for the page's mapping list */
+};
+
+/* A page of file data shared by read() and every mapping of it */
+struct pcache_page{
+  struct inode* inode;          /* Owner of the data */
+  off_t ofs;                    /* Page-aligned offset in the file */
+  uint8_t* kpage;               /* Kernel address of the data */
+  int pin_cnt;                  /* In-flight copies and loads using the page */
+  bool loading;                 /* Being read from the file */
+  bool dirty;                   /* Written through a mapping, not yet written back */
+  struct list mappings;         /* User pages mapping it */
+  struct hash_elem h_elem;      /* Element for the page cache hash table */
+  struct list_elem lru_elem;    /* Element for the LRU list */
+};
+
+/* Initialization of page cache, used in init.c */
+void pcache_init(void);
+
+/* Sharing pages between mappings */
+uint8_t* pcache_map(struct inode* inode, off_t ofs, void* upage);
+void pcache_unmap(struct inode* inode, off_t ofs, void* upage, bool dirty);
+
+/* Copying between the page cache and user buffers */
+off_t pcache_read(struct inode* inode, void* buffer, off_t size, off_t ofs);
+void pcache_write(struct inode* inode, const void* buffer, off_t size, off_t ofs);
+
+/* Functionality needed by other parts */
+void pcache_inode_close(struct inode* inode);
+bool pcache_reclaim(void);
+
+#endif
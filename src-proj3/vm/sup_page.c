@@ -1,73 +1,69 @@
 #include "vm/sup_page.h"
 #include "vm/frame.h"
+#include "vm/page_cache.h"
 #include "threads/pte.h"
 #include "threads/vaddr.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "filesys/file.h"
 
-unsigned int
-compute_page_hash_value(const struct hash_elem *e, void *aux UNUSED)
+static struct slab_cache supp_page_cache;   /* Supplemental page table entries */
+
+/* Initialize the allocator of supp_page entries, used in init.c */
+void
+supp_page_init(void)
 {
-  struct supp_page* spage = hash_entry(e, struct supp_page, h_elem);
-  return hash_bytes(&spage->user_vaddr, sizeof spage->user_vaddr);
+  slab_cache_init(&supp_page_cache, "supp_page", sizeof(struct supp_page), 0, NULL);
+  return;
 }
 
-bool
-compare_page_hash_value(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+/* Allocate a supp_page entry, NULL if memory is exhausted */
+struct supp_page*
+supp_page_alloc(void)
+{
+  return slab_alloc(&supp_page_cache);
+}
+
+/* Free a supp_page entry allocated by supp_page_alloc() */
+void
+supp_page_free(struct supp_page* spge)
 {
-  const struct supp_page* spage_a = hash_entry(a, struct supp_page, h_elem);
-  const struct supp_page* spage_b = hash_entry(b, struct supp_page, h_elem);
-  return spage_a->user_vaddr < spage_b->user_vaddr;
+  slab_free(&supp_page_cache, spge);
+  return;
 }
 
+/* Free a sup_page entry when its process's page table is destroyed */
 void
-free_page_table_entry(const struct hash_elem *e, void *aux UNUSED)
+free_page_table_entry(size_t key UNUSED, void* value)
 {
-  struct supp_page* spage = hash_entry(e, struct supp_page, h_elem);
-  free(spage);
+  supp_page_free(value);
 }
 
-/* Given a hash table and a key, find the corresponding entry */
+/* Given a page table keyed by user page number and an address,
+   find the entry of the page holding it.  The page_table_lock of
+   the table's process must be held */
 struct supp_page*
-find_fake_pte(struct hash *hash_table, void *key)
+find_fake_pte(struct radix_tree *page_table, void *key)
 {
-  ASSERT(hash_table != NULL);     /* Assert the given hash table ptr is not a NULL */
+  ASSERT(page_table != NULL);     /* Assert the given page table ptr is not a NULL */
   ASSERT(key != NULL);            /* Assert the given key ptr is not a NULL */
 
-  struct supp_page* fake_pte = NULL;
-  struct supp_page* target = malloc(sizeof(struct supp_page));
-  if(target == NULL){
-    goto done;
-  }
-  else{
-    target->user_vaddr = key;
-    struct hash_elem* he = hash_find(hash_table, &target->h_elem);
-    
-    free(target);
-    if(he == NULL){
-      goto done;
-    }
-    else{
-      fake_pte = hash_entry(he, struct supp_page, h_elem);
-    }
-  }
-
-done:
-  return fake_pte;
+  return radix_lookup(page_table, pg_no(key));
 }
 
-/* Create a supp_page entry(a reserved but not allocated page) */
+/* Create a supp_page entry(a reserved but not allocated page) in
+   the current process's page table, whose lock must be held */
 bool
 supp_page_entry_create(enum supp_type type, struct file *file, off_t ofs, uint8_t *upage,
                         uint32_t read_bytes, uint32_t zero_bytes, bool writable)
 {
   ASSERT(is_user_vaddr(upage));   /* Assert the given user addr is really in user space */
+  ASSERT(lock_held_by_current_thread(&thread_current()->main_t->page_table_lock));
 
   bool success = false;
 
-  struct supp_page* spge = malloc(sizeof(struct supp_page));
+  struct supp_page* spge = supp_page_alloc();
   if(spge == NULL){
     goto done;
   }
@@ -76,6 +72,7 @@ supp_page_entry_create(enum supp_type type, struct file *file, off_t ofs, uint8_
 
     switch(spge->type){
       case LAZY_LOAD:
+      case FILE_MAPPED:
       {
         entry_setting_lazy(spge, file, ofs, upage, read_bytes, zero_bytes, writable);
         break;
@@ -89,9 +86,8 @@ supp_page_entry_create(enum supp_type type, struct file *file, off_t ofs, uint8_
     }
 
     /* Insert this new entry into current process's sup-page-table */
-    struct hash_elem * he = hash_insert (&thread_current()->page_table, &spge->h_elem);
-
-    if(he != NULL){     /* If this new sup-page-entry has existed */
+    if(!radix_insert(&thread_current()->main_t->page_table,
+                     pg_no(spge->user_vaddr), spge)){     /* Existed already, or out of memory */
       goto done;
     }
 
@@ -142,6 +138,9 @@ bool
 fake2real_page_convert(struct supp_page* spge)
 {
   ASSERT(spge != NULL);
+  if(spge->type == FILE_MAPPED){
+    return mapped2real_page_convert(spge);
+  }
   ASSERT(spge->type == LAZY_LOAD);
   
   uint8_t* upage = spge->user_vaddr; 
@@ -188,14 +187,43 @@ done:
   return success;
 }
 
+/* Map the page cache page holding this part of the file, shared
+   with every other mapping of it.  When memory runs short the cache
+   may unmap it again, turning SPGE back into a fake page */
+bool
+mapped2real_page_convert(struct supp_page* spge)
+{
+  ASSERT(spge != NULL);
+  ASSERT(spge->type == FILE_MAPPED && spge->fake_page);
+
+  struct inode* inode = file_get_inode(spge->file_in_this_page);
+  bool success = false;
+
+  uint8_t* kpage = pcache_map(inode, spge->load_offset, spge->user_vaddr);
+  if(kpage == NULL){
+    goto done;
+  }
+  if(!pagedir_set_page(thread_current()->pagedir, spge->user_vaddr, kpage, spge->writable)){
+    pcache_unmap(inode, spge->load_offset, spge->user_vaddr, false);
+    goto done;
+  }
+
+  success = true;
+  spge->fake_page = false;
+
+done:
+  return success;
+}
+
 bool
 create_evicted_pte(struct thread* t, size_t swap_idx, void* uvaddr)
 {
   ASSERT(t != NULL && t->magic == 0xcd6abf4b);
+  ASSERT(lock_held_by_current_thread(&t->page_table_lock));
 
   bool success = false;
 
-  struct supp_page* spge = malloc(sizeof(struct supp_page));
+  struct supp_page* spge = supp_page_alloc();
   if(spge == NULL){
     goto done;
   }
@@ -205,8 +233,7 @@ create_evicted_pte(struct thread* t, size_t swap_idx, void* uvaddr)
   spge->user_vaddr = (uint8_t*)uvaddr;
 
   /* Insert this new entry into corresponding process's sup-page-table */
-  struct hash_elem * he = hash_insert(&t->page_table, &spge->h_elem);
-  if(he != NULL){     /* If this new sup-page-entry has existed */
+  if(!radix_insert(&t->page_table, pg_no(spge->user_vaddr), spge)){     /* Existed already, or out of memory */
     goto done;
   }
 
@@ -264,6 +291,7 @@ try_to_unmap(struct supp_page* spge, int advance, int write_length)
   ASSERT(spge != NULL);
   
   struct thread* cur = thread_current();
+  ASSERT(lock_held_by_current_thread(&cur->main_t->page_table_lock));
 
   switch(spge->type){
     case LAZY_LOAD:         /* Still a fake, unmapped page. So nothing to do*/
@@ -275,23 +303,32 @@ try_to_unmap(struct supp_page* spge, int advance, int write_length)
 
     case CO_EXIST:          /* A mapped page, unmap it */
     {
-      /* Retrieve the kpage and frame table entry */
+      /* Retrieve the kpage */
       void* kpage = pagedir_get_page(cur->pagedir, spge->user_vaddr);
       ASSERT(kpage != NULL);
-      struct frame* f = find_frame_table_entry_by_frame(kpage);
-      ASSERT(f != NULL);
       
       /* If the page to be unmapped is dirty, write it back to file */
       if(pagedir_is_dirty(cur->pagedir, spge->user_vaddr)){
         file_write_at(spge->file_in_this_page, spge->user_vaddr, write_length, advance);
       }
 
-      free_frame(f);                                        /* Clear frame table entry */
+      free_frame_of_page(kpage);                            /* Clear frame table entry */
       pagedir_clear_page(cur->pagedir, spge->user_vaddr);   /* Unmap */
 
       break;
     }
 
+    case FILE_MAPPED:       /* Shared page, give it back to the page cache */
+    {
+      if(!spge->fake_page){
+        bool dirty = pagedir_is_dirty(cur->pagedir, spge->user_vaddr);
+        pagedir_clear_page(cur->pagedir, spge->user_vaddr);   /* Unmap */
+        pcache_unmap(file_get_inode(spge->file_in_this_page), spge->load_offset,
+                     spge->user_vaddr, dirty);
+      }
+      break;
+    }
+
     case EVICTED:
     {
       /* If evicted, no kernel page can be found */
@@ -307,12 +344,10 @@ try_to_unmap(struct supp_page* spge, int advance, int write_length)
         }
         file_write_at(spge->file_in_this_page, spge->user_vaddr, PGSIZE, advance);
 
-        /* Get the reclaimation kernel vaddr and frame table, free and unmap it */
+        /* Get the reclaimation kernel vaddr, free and unmap it */
         kpage = pagedir_get_page(cur->pagedir, spge->user_vaddr);
         ASSERT(kpage != NULL);
-        f = find_frame_table_entry_by_frame(kpage);
-        ASSERT(f != NULL);
-        free_frame(f);
+        free_frame_of_page(kpage);
         pagedir_clear_page(cur->pagedir, spge->user_vaddr);
       }
       else{   /* If not dirty, clear the swap slot */
@@ -324,6 +359,7 @@ try_to_unmap(struct supp_page* spge, int advance, int write_length)
   }
 
   /* Remove the supplemental page table entry */
-  ASSERT(hash_delete(&cur->page_table, &spge->h_elem));
+  struct supp_page* removed = radix_delete(&cur->main_t->page_table, pg_no(spge->user_vaddr));
+  ASSERT(removed == spge);
   return true;
 }
\ No newline at end of file
@@ -4,15 +4,16 @@
 #include <stdio.h>
 #include "threads/thread.h"
 #include "threads/palloc.h"
-#include "lib/kernel/hash.h"
+#include "lib/kernel/radix.h"
 #include "filesys/file.h"
 
-/* Three types of supplemental pte. One pte can only has one type */
+/* Four types of supplemental pte. One pte can only has one type */
 enum supp_type
 {
   LAZY_LOAD,          /* Only supplemental page table entry exists, for lazy load */
   CO_EXIST,           /* Both supplemental pte and real page exist */
   EVICTED,            /* Only supplemental page table entry exists, for swap */
+  FILE_MAPPED,        /* Memory-mapped file page, shared through the page cache */
 };
 
 /* Supplementary page table(assistor of real page table)
@@ -31,14 +32,15 @@ struct supp_page
   bool fake_page;                 /* Inidicate this page is a fake page or real */ 
 
   size_t swap_idx;                /* Record which swap slot evicted to(only for type:EVICTED) */  
-  
-  struct hash_elem h_elem;    /* Element for hash table */
 };
 
+/* Allocation of sup_page entries */
+void supp_page_init(void);
+struct supp_page* supp_page_alloc(void);
+void supp_page_free(struct supp_page* spge);
+
 /* Auxilary functionality for hash page table */
-unsigned int compute_page_hash_value(const struct hash_elem *e, void *aux UNUSED);
-bool compare_page_hash_value(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED);
-void free_page_table_entry(const struct hash_elem *e, void *aux UNUSED);
+void free_page_table_entry(size_t key, void* value);
 
 /* Basic lifecycle of a sup_page entry */
 bool supp_page_entry_create(enum supp_type type, struct file *file, off_t ofs, uint8_t *upage,
@@ -48,8 +50,9 @@ void entry_setting_lazy(struct supp_page* sup, struct file *file, off_t ofs, uin
 void entry_setting_co(struct supp_page* sup, struct file* f, uint8_t *upage);
 
 /* Auxilary functionality for other parts */
-struct supp_page* find_fake_pte(struct hash *hash_table, void *key);
+struct supp_page* find_fake_pte(struct radix_tree *page_table, void *key);
 bool fake2real_page_convert(struct supp_page* spge);
+bool mapped2real_page_convert(struct supp_page* spge);
 bool create_evicted_pte(struct thread* t, size_t swap_idx, void* uvaddr);
 bool real2evicted_page_convert(struct supp_page* spge, size_t swap_idx);
 bool try_to_do_reclaimation(struct supp_page* spge);
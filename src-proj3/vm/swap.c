@@ -24,6 +24,7 @@ block_device_create(void)
   }
 
   lock_init(&swap_lock);
+  lock_set_name(&swap_lock, "swap_lock");
 
   success = true;
 
@@ -34,7 +35,7 @@ done:
 size_t
 next_start_to_swap(void)
 {
-  size_t next_start = bitmap_scan_and_flip(swap_space_map, 0, 1, false);
+  size_t next_start = bitmap_scan_and_flip_next(swap_space_map, 1, false);
   return next_start;
 }
 
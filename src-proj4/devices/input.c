@@ -41,6 +41,34 @@ input_getc (void)
   return key;
 }
 
+/* Like input_getc(), but gives up and returns false instead of
+   waiting once STOP returns true.  Otherwise stores the key in
+   *KEY and returns true. */
+bool
+input_getc_unless (bool (*stop) (void), uint8_t *key) 
+{
+  enum intr_level old_level;
+  bool success;
+
+  old_level = intr_disable ();
+  success = intq_getc_unless (&buffer, stop, key);
+  if (success)
+    serial_notify ();
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Wakes up the thread waiting in input_getc_unless(), if any, to
+   recheck its stop condition. */
+void
+input_kick (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  intq_kick (&buffer);
+  intr_set_level (old_level);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
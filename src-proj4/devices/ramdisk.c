@@ -0,0 +1,118 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* The code in this file is a block device backed by kernel
+   memory instead of a disk.  It has no seek or transfer latency,
+   so a file system or swap area placed on it exposes the CPU
+   cost of the layers above the block device. */
+
+/* Number of sectors stored in each page of a RAM disk. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk.
+   The contents are kept in individually allocated pages rather
+   than one contiguous region, so that a large RAM disk does not
+   depend on finding that many consecutive free kernel pages. */
+struct ramdisk
+  {
+    block_sector_t size;        /* Size in sectors. */
+    size_t page_cnt;            /* Number of pages in PAGES. */
+    uint8_t **pages;            /* Backing pages. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+/* Returns the address of SECTOR within RD. */
+static uint8_t *
+sector_addr (const struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Creates and registers a RAM disk named NAME of SIZE sectors
+   with the given TYPE.  The disk is initially zeroed.  If
+   PRELOAD is non-null, the first sectors of the disk are then
+   filled in from PRELOAD, up to the size of the smaller of the
+   two devices.
+
+   Panics if memory for the disk cannot be allocated, since the
+   kernel command line asked for this disk explicitly. */
+struct block *
+ramdisk_create (const char *name, enum block_type type,
+                block_sector_t size, struct block *preload)
+{
+  struct ramdisk *rd;
+  char extra_info[64];
+  size_t i;
+
+  ASSERT (size > 0);
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("Failed to allocate memory for RAM disk descriptor");
+  rd->size = size;
+  rd->page_cnt = DIV_ROUND_UP (size, SECTORS_PER_PAGE);
+  rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("Failed to allocate memory for RAM disk page array");
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("%s: out of kernel memory after %zu of %zu pages",
+               name, i, rd->page_cnt);
+    }
+
+  if (preload != NULL)
+    {
+      block_sector_t cnt = block_size (preload);
+      block_sector_t sector;
+
+      if (cnt > size)
+        cnt = size;
+      for (sector = 0; sector < cnt; sector++)
+        block_read (preload, sector, sector_addr (rd, sector));
+      snprintf (extra_info, sizeof extra_info,
+                "RAM disk, %"PRDSNu" sectors preloaded from %s",
+                cnt, block_name (preload));
+    }
+  else
+    strlcpy (extra_info, "RAM disk", sizeof extra_info);
+
+  return block_register (name, type, extra_info, size,
+                         &ramdisk_operations, rd);
+}
+
+/* Reads sector SEC_NO from RAM disk RD_, which must be a pointer
+   to a struct ramdisk, into BUFFER, which must have room for
+   BLOCK_SECTOR_SIZE bytes.  The block layer has already checked
+   that SEC_NO is in range. */
+static void
+ramdisk_read (void *rd_, block_sector_t sec_no, void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  memcpy (buffer, sector_addr (rd, sec_no), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes BLOCK_SECTOR_SIZE bytes from BUFFER to sector SEC_NO
+   of RAM disk RD_, which must be a pointer to a struct
+   ramdisk. */
+static void
+ramdisk_write (void *rd_, block_sector_t sec_no, const void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  memcpy (sector_addr (rd, sec_no), buffer, BLOCK_SECTOR_SIZE);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write
+  };
@@ -0,0 +1,9 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include "devices/block.h"
+
+struct block *ramdisk_create (const char *name, enum block_type,
+                              block_sector_t size, struct block *preload);
+
+#endif /* devices/ramdisk.h */
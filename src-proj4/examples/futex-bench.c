@@ -0,0 +1,84 @@
+/* futex-bench.c
+
+   Measures what the futex-based user mutex costs.  Uncontended
+   lock/unlock pairs never enter the kernel, so they should cost a
+   few atomic instructions; compare them with a futex_wake() that
+   finds nobody to wake, which is one kernel round trip, and with
+   lock/unlock pairs fought over by several threads, which sleep
+   in the kernel whenever they lose.
+
+   Usage: futex-bench [ITERATIONS] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <synch.h>
+#include <syscall.h>
+
+/* Threads in the contended run. */
+#define THREAD_CNT 4
+
+static struct mutex m;
+static int iterations;
+
+/* Returns the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Locks and unlocks M ITERATIONS times. */
+static void
+lock_loop (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < iterations; i++) 
+    {
+      mutex_lock (&m);
+      mutex_unlock (&m);
+    }
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  static int word;
+  tid_t tids[THREAD_CNT];
+  uint64_t start, lock_cycles, wake_cycles, contended_cycles;
+  int i;
+
+  iterations = argc > 1 ? atoi (argv[1]) : 100000;
+  if (iterations <= 0)
+    exit (1);
+
+  mutex_init (&m);
+  start = rdtsc ();
+  lock_loop (NULL);
+  lock_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    futex_wake (&word, 1);
+  wake_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if ((tids[i] = thread_create (lock_loop, NULL)) == TID_ERROR)
+      exit (2);
+  for (i = 0; i < THREAD_CNT; i++)
+    thread_join (tids[i]);
+  contended_cycles = rdtsc () - start;
+
+  printf ("futex-bench: %d iterations\n", iterations);
+  printf ("  mutex lock+unlock: %llu cycles each\n",
+          lock_cycles / iterations);
+  printf ("  futex_wake syscall: %llu cycles each\n",
+          wake_cycles / iterations);
+  printf ("  mutex lock+unlock, %d threads: %llu cycles each\n",
+          THREAD_CNT, contended_cycles / ((uint64_t) iterations * THREAD_CNT));
+  return EXIT_SUCCESS;
+}
@@ -1,18 +1,29 @@
 #include <debug.h>
+#include <round.h>
 #include <string.h>
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
-#include "threads/malloc.h"
+#include "filesys/journal.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 #include "devices/timer.h"
 
 #define LATEST_TIME 0xefffffff
 
+/* Sector buffers of all cache lines, on pages of their own so
+   that memory accounting counts them as cache */
+static char* cache_data;
+
 /* Initialize the whole buffer cache */
 void
 cache_init(void)
 {
   /* Initialize the cache lock */
   lock_init(&cache_lock);
+  lock_set_name(&cache_lock, "cache_lock");
+
+  cache_data = palloc_get_multiple(PAL_ASSERT | PAL_TAG(PAL_TAG_CACHE),
+                                   DIV_ROUND_UP(CACHE_SIZE * BLOCK_SECTOR_SIZE, PGSIZE));
 
   /* Initialize all 64 cache lines */
   lock_acquire(&cache_lock);
@@ -36,6 +47,21 @@ cache_clear(void)
   return;
 }
 
+/* Write back every dirty cache line without invalidating it,
+   used by the sync system call */
+void
+cache_flush(void)
+{
+  lock_acquire(&cache_lock);
+  for(int i = 0; i < CACHE_SIZE; i ++){
+    if(cache[i].valid_bit && !cache[i].available && cache[i].dirty_bit){
+      cache_write_back(&cache[i]);
+    }
+  }
+  lock_release(&cache_lock);
+  return;
+}
+
 /* Function for checking cache hit or miss */
 /* This function will be called before every access to cache,
    so update cache line's accessed_time here */
@@ -67,8 +93,9 @@ cache_line_init(struct cache_line* cl)
   cl->dirty_bit = false;
   cl->available = true;
   cl->accessed_time = timer_ticks();
-  cl->buffer = (char*)malloc(BLOCK_SECTOR_SIZE);
-  ASSERT(cl->buffer != NULL);
+  cl->logged = false;
+  cl->owner_dirty = NULL;
+  cl->buffer = cache_data + (cl - cache) * BLOCK_SECTOR_SIZE;
 
   return;
 }
@@ -154,8 +181,18 @@ cache_write_back(struct cache_line* cl)
   ASSERT(cl != NULL);
   ASSERT(cl->valid_bit == true && cl->dirty_bit == true);
   
-  block_write(fs_device, cl->sector_idx, cl->buffer);
+  /* A sector in the journal reaches its home location at commit */
+  if(!cl->logged || !journal_contains(cl->sector_idx)){
+    block_write(fs_device, cl->sector_idx, cl->buffer);
+    cl->logged = false;
+  }
   cl->dirty_bit = false;
+
+  /* A clean line no longer belongs to its inode's dirty list */
+  if(cl->owner_dirty != NULL){
+    list_remove(&cl->dirty_elem);
+    cl->owner_dirty = NULL;
+  }
   return;
 }
 
@@ -167,16 +204,18 @@ cache_fetch_in(struct cache_line* cl)
   ASSERT(cl != NULL);
   ASSERT(cl->valid_bit == true);
 
-  block_read(fs_device, cl->sector_idx, cl->buffer);
+  /* The journal may hold a newer copy than the disk */
+  cl->logged = journal_read(cl->sector_idx, cl->buffer);
+  if(!cl->logged){
+    block_read(fs_device, cl->sector_idx, cl->buffer);
+  }
 }
 
-/* Other parts through this function to access cache and do operations */
-/* read_or_write = true: read 
-   read_or_write = false: write */
-void
-cache_do(bool read_or_write, block_sector_t sec, void* mem_addr)
+/* Return the line holding SEC, fetching it in on a miss */
+static struct cache_line*
+cache_get_line(block_sector_t sec, bool read_or_write)
 {
-  lock_acquire(&cache_lock);
+  ASSERT(lock_held_by_current_thread(&cache_lock));
 
   struct cache_line* target_line = check_hit_or_not(sec);
   if(target_line == NULL){/* Cache miss */
@@ -196,15 +235,101 @@ cache_do(bool read_or_write, block_sector_t sec, void* mem_addr)
   }
 
   ASSERT(target_line != NULL);
+  return target_line;
+}
 
+/* Other parts through this function to access cache and do operations */
+/* read_or_write = true: read 
+   read_or_write = false: write */
+void
+cache_do(bool read_or_write, block_sector_t sec, void* mem_addr)
+{
+  cache_do_owned(read_or_write, sec, mem_addr, NULL);
+}
+
+/* Same as cache_do(), but a line dirtied by a write is also put on
+   OWNER_DIRTY, the list of dirty lines of the inode the sector
+   belongs to, so that the inode can be flushed on its own */
+void
+cache_do_owned(bool read_or_write, block_sector_t sec, void* mem_addr,
+               struct list* owner_dirty)
+{
+  lock_acquire(&cache_lock);
+
+  struct cache_line* target_line = cache_get_line(sec, read_or_write);
   if(read_or_write){
     memcpy(mem_addr, (const void*)(target_line->buffer), BLOCK_SECTOR_SIZE);
   }
   else{
     target_line->dirty_bit = true;
     memcpy((void*)(target_line->buffer), (const void*)mem_addr, BLOCK_SECTOR_SIZE);
+    if(target_line->logged){          /* Keep the logged copy up to date */
+      target_line->logged = journal_absorb(sec, mem_addr);
+    }
+
+    if(target_line->owner_dirty != owner_dirty){
+      if(target_line->owner_dirty != NULL){
+        list_remove(&target_line->dirty_elem);
+      }
+      target_line->owner_dirty = owner_dirty;
+      if(owner_dirty != NULL){
+        list_push_back(owner_dirty, &target_line->dirty_elem);
+      }
+    }
+  }
+
+  lock_release(&cache_lock);
+  return;
+}
+
+/* Write SEC from MEM_ADDR on behalf of the journal, which has just
+   logged these contents.  The line is marked logged, so the journal,
+   not the cache, writes it home */
+void
+cache_write_logged(block_sector_t sec, const void* mem_addr)
+{
+  lock_acquire(&cache_lock);
+
+  struct cache_line* target_line = cache_get_line(sec, false);
+  target_line->dirty_bit = true;
+  target_line->logged = true;
+  memcpy((void*)(target_line->buffer), mem_addr, BLOCK_SECTOR_SIZE);
+
+  /* Metadata belongs to no inode's dirty list */
+  if(target_line->owner_dirty != NULL){
+    list_remove(&target_line->dirty_elem);
+    target_line->owner_dirty = NULL;
   }
 
+  lock_release(&cache_lock);
+  return;
+}
+
+/* Write back the dirty lines on OWNER_DIRTY, touching no other line */
+void
+cache_flush_owned(struct list* owner_dirty)
+{
+  lock_acquire(&cache_lock);
+  while(!list_empty(owner_dirty)){
+    struct cache_line* cl = list_entry(list_front(owner_dirty),
+                                       struct cache_line, dirty_elem);
+    cache_write_back(cl);             /* Also removes CL from the list */
+  }
+  lock_release(&cache_lock);
+  return;
+}
+
+/* Detach the lines on OWNER_DIRTY before the list goes away; they
+   stay dirty and are written back on eviction as usual */
+void
+cache_disown(struct list* owner_dirty)
+{
+  lock_acquire(&cache_lock);
+  while(!list_empty(owner_dirty)){
+    struct cache_line* cl = list_entry(list_pop_front(owner_dirty),
+                                       struct cache_line, dirty_elem);
+    cl->owner_dirty = NULL;
+  }
   lock_release(&cache_lock);
   return;
 }
\ No newline at end of file
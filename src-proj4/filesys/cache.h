@@ -1,6 +1,7 @@
 #ifndef FILESYS_CACHE_H
 #define FILESYS_CACHE_H
 
+#include <list.h>
 #include "devices/block.h"
 #include "threads/synch.h"
 
@@ -16,6 +17,10 @@ struct cache_line
 
   block_sector_t sector_idx;        /* Record which sector should this cache line write back */
   char* buffer;                     /* Content of this cache line(512 bytes) */
+
+  bool logged;                      /* May be in the journal, false if surely not */
+  struct list* owner_dirty;         /* Dirty line list of the owning inode, or NULL */
+  struct list_elem dirty_elem;      /* Element in OWNER_DIRTY */
 };
 
 /* The whole cache, an array of cache lines */
@@ -27,6 +32,7 @@ struct lock cache_lock;
 /* Cache system operations */
 void cache_init(void);
 void cache_clear(void);
+void cache_flush(void);
 struct cache_line* check_hit_or_not(block_sector_t sec);
 
 /* Cache line operations */
@@ -38,5 +44,12 @@ void evict_cache_line(struct cache_line* cl);
 void cache_write_back(struct cache_line* cl);
 void cache_fetch_in(struct cache_line* cl);
 void cache_do(bool read_or_write, block_sector_t sec, void* mem_addr);
+void cache_write_logged(block_sector_t sec, const void* mem_addr);
+
+/* Per-inode dirty tracking */
+void cache_do_owned(bool read_or_write, block_sector_t sec, void* mem_addr,
+                    struct list* owner_dirty);
+void cache_flush_owned(struct list* owner_dirty);
+void cache_disown(struct list* owner_dirty);
 
 #endif
\ No newline at end of file
@@ -16,6 +16,8 @@ struct inode;
 /* Path ---> dir + filename */
 void split_path_to_dir_filename(const char* full_path, char* dir, char* filename);
 
+void dir_init (void);
+
 /* Opening and closing directories. */
 bool dir_create (block_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
@@ -7,6 +7,7 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/cache.h"
+#include "filesys/journal.h"
 #include "threads/thread.h"
 
 /* Partition that contains the file system. */
@@ -24,11 +25,15 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  dir_init ();
   free_map_init ();
   cache_init();
+  journal_init();
 
   if (format) 
     do_format ();
+  else
+    journal_recover();
 
   free_map_open ();
 }
@@ -39,9 +44,19 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  journal_flush();
   cache_clear();
 }
 
+/* Writes all dirty file data to disk, then commits the journal
+   so that file system metadata follows it. */
+void
+filesys_sync (void) 
+{
+  cache_flush();
+  journal_flush();
+}
+
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
@@ -63,6 +78,7 @@ filesys_create (const char *name, off_t initial_size, bool is_dir)
   dir = dir_general_open(dir_name);
 
   /* Open the directory */
+  journal_begin();
   bool success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
                   && inode_create (inode_sector, initial_size, is_dir)
@@ -70,6 +86,7 @@ filesys_create (const char *name, off_t initial_size, bool is_dir)
   if (!success && inode_sector != 0){
     free_map_release (inode_sector, 1);
   }
+  journal_end();
   dir_close (dir);
 
   free(dir_name);
@@ -136,7 +153,9 @@ filesys_remove (const char *name)
   struct dir *dir;
   dir = dir_general_open(dir_name);
 
+  journal_begin();
   bool success = dir != NULL && dir_remove (dir, file_name);
+  journal_end();
   dir_close (dir); 
   
   free(dir_name);
@@ -169,6 +188,7 @@ static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  journal_format ();
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
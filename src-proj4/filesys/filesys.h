@@ -17,5 +17,6 @@ bool filesys_create (const char *name, off_t initial_size, bool is_dir);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
 bool filesys_change_dir(const char *dir);
+void filesys_sync (void);
 
 #endif /* filesys/filesys.h */
@@ -3,9 +3,12 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -43,6 +46,7 @@ bool indexed_inode_dealloc(struct inode_disk *disk_inode, size_t sectors);
 
 /* Helper function */
 void zero_array_init(block_sector_t* array);
+static void inode_sector_write(struct inode *inode, block_sector_t sec, const void *buffer);
 
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -61,6 +65,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct list dirty_lines;            /* Dirty cache lines holding our data. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -108,11 +113,15 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* In-memory inodes. */
+static struct slab_cache inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  slab_cache_init (&inode_cache, "inode", sizeof (struct inode), 0, NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -139,10 +148,12 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
       disk_inode->length = length;
       disk_inode->is_dir = is_dir;
       disk_inode->magic = INODE_MAGIC;
+      journal_begin();
       if(indexed_inode_allocate(disk_inode, sectors)){
-        cache_do(false, sector, disk_inode);
+        journal_write(sector, disk_inode);
         success = true;
       }
+      journal_end();
       free (disk_inode);
     }
 
@@ -171,7 +182,7 @@ inode_open (block_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = slab_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -181,6 +192,7 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  list_init (&inode->dirty_lines);
   // block_read (fs_device, inode->sector, &inode->data);
   cache_do(true, inode->sector, &inode->data);
   return inode;
@@ -222,11 +234,14 @@ inode_close (struct inode *inode)
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          journal_begin();
           free_map_release (inode->sector, 1);
           indexed_inode_dealloc(&inode->data, bytes_to_sectors(inode->data.length)); 
+          journal_end();
         }
 
-      free (inode); 
+      cache_disown (&inode->dirty_lines);
+      slab_free (&inode_cache, inode); 
     }
 }
 
@@ -314,6 +329,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     return 0;
   }
 
+  /* File extension and directory or free map contents are metadata */
+  journal_begin();
+
   /* Before write, check whether need to do file extension and do it if needed */
   if(byte_to_sector(inode, offset + size - 1) == -1u){
     /* Calculate:
@@ -342,32 +360,32 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     /* Do extension, return 0 if any failure occurs */
     if(start_layer == 0){
       if(!direct_inode_create(&inode->data, &lack_sectors, occupied_sectors)){
-        return 0;
+        goto done;
       }
       if(lack_bytes > 0){
         if(!indirect_inode_create1(&inode->data, &lack_sectors, 0)){
-          return 0;
+          goto done;
         }
       }
       if(lack_sectors > 0){
         if(!indirect_inode_create2(&inode->data, &lack_sectors, 0)){
-          return 0;
+          goto done;
         }
       }
     }
     else if(start_layer == 1){
       if(!indirect_inode_create1(&inode->data, &lack_sectors, occupied_sectors)){
-        return 0;
+        goto done;
       }
       if(lack_sectors > 0){
         if(!indirect_inode_create2(&inode->data, &lack_sectors, 0)){
-          return 0;
+          goto done;
         }
       }
     }
     else{
       if(!indirect_inode_create2(&inode->data, &lack_sectors, occupied_sectors)){
-        return 0;
+        goto done;
       }
     }
 
@@ -376,7 +394,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
     /* Update the metadata of the file */
     inode->data.length = offset + size;
-    cache_do(false, inode->sector, &inode->data);
+    journal_write(inode->sector, &inode->data);
   }
 
   while (size > 0) 
@@ -399,7 +417,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
         {
           /* Write full sector directly to disk. */
           // block_write (fs_device, sector_idx, buffer + bytes_written);
-          cache_do(false, sector_idx, buffer + bytes_written);
+          inode_sector_write(inode, sector_idx, buffer + bytes_written);
         }
       else 
         {
@@ -422,7 +440,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
           // block_write (fs_device, sector_idx, bounce);
-          cache_do(false, sector_idx, bounce);
+          inode_sector_write(inode, sector_idx, bounce);
         }
 
       /* Advance. */
@@ -430,7 +448,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+
+done:
   free (bounce);
+  journal_end();
 
   return bytes_written;
 }
@@ -455,6 +476,18 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Writes INODE's dirty data to disk, then commits the journal so
+   that its inode and index sectors follow.  Data goes first, so
+   after a crash the committed metadata never points to blocks
+   whose contents were not yet written. */
+void
+inode_sync (struct inode *inode)
+{
+  ASSERT (inode != NULL);
+  cache_flush_owned (&inode->dirty_lines);
+  journal_flush ();
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
@@ -539,7 +572,7 @@ indirect_inode_create1(struct inode_disk *disk_inode, size_t* sectors, off_t ofs
     }
     *sectors -= 1;
   }
-  cache_do(false, disk_inode->indirect_sector_idx, indirect_sectors_array);
+  journal_write(disk_inode->indirect_sector_idx, indirect_sectors_array);
   success = true;
 
 done:
@@ -589,10 +622,10 @@ indirect_inode_create2(struct inode_disk *disk_inode, size_t* sectors, off_t ofs
       }
       *sectors -= 1;
     }
-    cache_do(false, indirect_sectors_array1[i], indirect_sectors_array2);
+    journal_write(indirect_sectors_array1[i], indirect_sectors_array2);
     offset2 = 0;
   }
-  cache_do(false, disk_inode->doubly_indirect_sector_idx, indirect_sectors_array1);
+  journal_write(disk_inode->doubly_indirect_sector_idx, indirect_sectors_array1);
   success = true;
 
 done:
@@ -724,6 +757,19 @@ done:
   return success;
 }
 
+/* Writes BUFFER to sector SEC of INODE's data, through the journal
+   if INODE holds file system metadata: a directory or the free map. */
+static void
+inode_sector_write(struct inode *inode, block_sector_t sec, const void *buffer)
+{
+  if(inode->data.is_dir || inode->sector == FREE_MAP_SECTOR){
+    journal_write(sec, buffer);
+  }
+  else{
+    cache_do_owned(false, sec, (void*)buffer, &inode->dirty_lines);
+  }
+}
+
 bool
 inode_is_removed(struct inode * node)
 {
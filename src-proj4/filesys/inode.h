@@ -19,6 +19,7 @@ off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+void inode_sync (struct inode *);
 
 bool inode_is_removed(struct inode * node);
 bool inode_is_dir(struct inode * node);
@@ -0,0 +1,361 @@
+#include <debug.h>
+#include <round.h>
+#include <string.h>
+#include "filesys/journal.h"
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Commit once this many transactions have ended since the last
+   commit, even if the journal still has room. */
+#define JOURNAL_GROUP_TXNS 64
+
+/* Home sectors listed in one descriptor sector */
+#define DESC_ENTRIES (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
+/* Slots in the index of logged blocks, at least twice
+   JOURNAL_CAPACITY so that probe sequences stay short */
+#define JOURNAL_INDEX_BITS 9
+#define JOURNAL_INDEX_SIZE (1 << JOURNAL_INDEX_BITS)
+
+/* On-disk journal header.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+   Writing a header with a nonzero CNT is the commit point of a
+   group of transactions; writing it back with CNT = 0 after the
+   blocks reach their home sectors retires the group. */
+struct journal_header
+  {
+    unsigned magic;                     /* Magic number. */
+    uint32_t seq;                       /* Commit sequence number. */
+    uint32_t cnt;                       /* Number of logged blocks. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 12];
+  };
+
+/* Journal of metadata sectors written since the last commit.
+   Every logged sector keeps its latest contents here until the
+   commit has written it to its home location, so the buffer cache
+   must neither write such a sector home itself nor read it back
+   from disk. */
+static block_sector_t journal_home[JOURNAL_CAPACITY];   /* Home sector of each logged block */
+static uint8_t* journal_data;                           /* Latest contents of each logged block */
+static size_t journal_cnt;                              /* Number of logged blocks */
+static uint32_t journal_seq;                            /* Sequence number of next commit */
+
+/* Logged blocks by home sector, open addressing with linear
+   probing.  A slot holds a block index plus one, or 0 if empty.
+   Blocks are only ever added until the commit empties it all */
+static uint16_t journal_index[JOURNAL_INDEX_SIZE];
+
+static int active_txns;             /* Outermost transactions in progress */
+static int reserved_sectors;        /* Sectors reserved by those transactions */
+static int ended_txns;              /* Transactions ended since the last commit */
+
+/* Synchronization variables for journal system */
+static struct lock journal_lock;
+static struct condition journal_room;
+
+static void journal_commit(void);
+static int journal_find(block_sector_t sec);
+static void journal_index_add(size_t idx);
+static void write_header(uint32_t cnt);
+
+/* Returns the in-memory copy of the IDX-th logged block */
+static inline uint8_t*
+journal_block(size_t idx)
+{
+  return journal_data + idx * BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the first slot of the index to probe for SEC */
+static inline size_t
+journal_hash(block_sector_t sec)
+{
+  return (uint32_t)(sec * 2654435761u) >> (32 - JOURNAL_INDEX_BITS);
+}
+
+/* Initialize the journal system, should be used after cache_init() */
+void
+journal_init(void)
+{
+  lock_init(&journal_lock);
+  lock_set_name(&journal_lock, "journal_lock");
+  cond_init(&journal_room);
+  ASSERT(JOURNAL_INDEX_SIZE >= 2 * JOURNAL_CAPACITY);
+  memset(journal_index, 0, sizeof journal_index);
+  journal_data = palloc_get_multiple(PAL_ASSERT | PAL_TAG(PAL_TAG_CACHE),
+                                     DIV_ROUND_UP(JOURNAL_CAPACITY * BLOCK_SECTOR_SIZE, PGSIZE));
+  journal_cnt = 0;
+  journal_seq = 0;
+  active_txns = 0;
+  reserved_sectors = 0;
+  ended_txns = 0;
+  return;
+}
+
+/* Write an empty journal, used when formatting the file system */
+void
+journal_format(void)
+{
+  write_header(0);
+  return;
+}
+
+/* Replay a group of transactions that was committed but not yet
+   fully written to its home sectors, should be used in filesys_init()
+   before anything is read through the buffer cache */
+void
+journal_recover(void)
+{
+  struct journal_header header;
+  block_sector_t desc[DESC_ENTRIES];
+  static uint8_t block[BLOCK_SECTOR_SIZE];
+
+  block_read(fs_device, JOURNAL_SECTOR, &header);
+  if(header.magic != JOURNAL_MAGIC){
+    PANIC("file system has no journal, reformat it with -f");
+  }
+  journal_seq = header.seq + 1;
+  if(header.cnt == 0){              /* Clean shutdown or retired commit */
+    return;
+  }
+  ASSERT(header.cnt <= JOURNAL_CAPACITY);
+
+  /* Copy every logged block to its home sector, in log order */
+  for(uint32_t i = 0; i < header.cnt; i ++){
+    if(i % DESC_ENTRIES == 0){
+      block_read(fs_device, JOURNAL_SECTOR + 1 + i / DESC_ENTRIES, desc);
+    }
+    block_read(fs_device, JOURNAL_SECTOR + 1 + JOURNAL_DESC_SECTORS + i, block);
+    block_write(fs_device, desc[i % DESC_ENTRIES], block);
+  }
+  write_header(0);
+  return;
+}
+
+/* Commit every transaction that has ended, used by filesys_done() */
+void
+journal_flush(void)
+{
+  lock_acquire(&journal_lock);
+  while(active_txns > 0){
+    cond_wait(&journal_room, &journal_lock);
+  }
+  journal_commit();
+  lock_release(&journal_lock);
+  return;
+}
+
+/* Start a transaction.  Transactions nest: only the outermost
+   begin of a thread reserves journal space, and the metadata
+   written until the matching journal_end() reaches the disk
+   atomically.  Blocks if the journal lacks room until the
+   transactions already logged are committed. */
+void
+journal_begin(void)
+{
+  struct thread* cur = thread_current();
+  if(cur->journal_depth++ > 0){     /* Nested transaction */
+    return;
+  }
+
+  lock_acquire(&journal_lock);
+  while(journal_cnt + reserved_sectors + JOURNAL_TXN_SECTORS > JOURNAL_CAPACITY){
+    if(active_txns == 0){
+      journal_commit();
+    }
+    else{
+      cond_wait(&journal_room, &journal_lock);
+    }
+  }
+  active_txns ++;
+  reserved_sectors += JOURNAL_TXN_SECTORS;
+  lock_release(&journal_lock);
+  return;
+}
+
+/* Finish a transaction started by journal_begin().  The group of
+   ended transactions is committed with one sequential write once
+   enough of them have accumulated. */
+void
+journal_end(void)
+{
+  struct thread* cur = thread_current();
+  ASSERT(cur->journal_depth > 0);
+  if(--cur->journal_depth > 0){     /* Nested transaction */
+    return;
+  }
+
+  lock_acquire(&journal_lock);
+  active_txns --;
+  reserved_sectors -= JOURNAL_TXN_SECTORS;
+  ended_txns ++;
+  if(active_txns == 0){
+    if(ended_txns >= JOURNAL_GROUP_TXNS
+       || journal_cnt + JOURNAL_TXN_SECTORS > JOURNAL_CAPACITY){
+      journal_commit();
+    }
+    cond_broadcast(&journal_room, &journal_lock);
+  }
+  lock_release(&journal_lock);
+  return;
+}
+
+/* Write metadata sector SEC from MEM_ADDR as part of the current
+   transaction */
+void
+journal_write(block_sector_t sec, const void* mem_addr)
+{
+  ASSERT(thread_current()->journal_depth > 0);
+
+  lock_acquire(&journal_lock);
+  int idx = journal_find(sec);
+  if(idx < 0){
+    if(journal_cnt >= JOURNAL_CAPACITY){
+      PANIC("journal overflow: transaction logged more than %d sectors",
+            JOURNAL_TXN_SECTORS);
+    }
+    idx = journal_cnt;
+  }
+  /* Fill in the block before publishing it, a cache miss on SEC
+     reads it through journal_read() as soon as it is listed */
+  memcpy(journal_block(idx), mem_addr, BLOCK_SECTOR_SIZE);
+  if(idx == (int)journal_cnt){
+    journal_home[journal_cnt++] = sec;
+    journal_index_add(idx);
+  }
+  lock_release(&journal_lock);
+
+  /* Marks the cache line logged, so that the cache passes later
+     writes of SEC on to journal_absorb() and leaves it in place */
+  cache_write_logged(sec, mem_addr);
+  return;
+}
+
+/* Cache miss hook: copy the logged contents of SEC into MEM_ADDR
+   and return true, or return false if SEC is not logged */
+bool
+journal_read(block_sector_t sec, void* mem_addr)
+{
+  bool found = false;
+  lock_acquire(&journal_lock);
+  int idx = journal_find(sec);
+  if(idx >= 0){
+    memcpy(mem_addr, journal_block(idx), BLOCK_SECTOR_SIZE);
+    found = true;
+  }
+  lock_release(&journal_lock);
+  return found;
+}
+
+/* Cache write hook: keep the logged copy of SEC up to date with
+   MEM_ADDR.  Returns true if SEC is logged.  Only called for lines
+   marked logged, which the commit leaves stale until this or
+   journal_contains() returns false */
+bool
+journal_absorb(block_sector_t sec, const void* mem_addr)
+{
+  bool found = false;
+  lock_acquire(&journal_lock);
+  int idx = journal_find(sec);
+  if(idx >= 0){
+    memcpy(journal_block(idx), mem_addr, BLOCK_SECTOR_SIZE);
+    found = true;
+  }
+  lock_release(&journal_lock);
+  return found;
+}
+
+/* Cache write back hook: returns true if SEC is logged, in which
+   case the journal, not the cache, writes it home */
+bool
+journal_contains(block_sector_t sec)
+{
+  lock_acquire(&journal_lock);
+  bool found = journal_find(sec) >= 0;
+  lock_release(&journal_lock);
+  return found;
+}
+
+/* Write all logged blocks to the journal region, commit them with
+   the header, then copy them to their home sectors and retire the
+   commit.  No transaction may be in progress. */
+static void
+journal_commit(void)
+{
+  ASSERT(lock_held_by_current_thread(&journal_lock));
+  ASSERT(active_txns == 0);
+
+  ended_txns = 0;
+  if(journal_cnt == 0){
+    return;
+  }
+
+  /* Descriptors and blocks first, then the commit header */
+  for(size_t i = 0; i < journal_cnt; i += DESC_ENTRIES){
+    block_sector_t desc[DESC_ENTRIES];
+    size_t n = journal_cnt - i < DESC_ENTRIES ? journal_cnt - i : DESC_ENTRIES;
+    memset(desc, 0, sizeof desc);
+    memcpy(desc, &journal_home[i], n * sizeof *desc);
+    block_write(fs_device, JOURNAL_SECTOR + 1 + i / DESC_ENTRIES, desc);
+  }
+  for(size_t i = 0; i < journal_cnt; i ++){
+    block_write(fs_device, JOURNAL_SECTOR + 1 + JOURNAL_DESC_SECTORS + i, journal_block(i));
+  }
+  write_header(journal_cnt);
+
+  /* Checkpoint: the blocks are safe in the journal now */
+  for(size_t i = 0; i < journal_cnt; i ++){
+    block_write(fs_device, journal_home[i], journal_block(i));
+  }
+  write_header(0);
+  journal_cnt = 0;
+  memset(journal_index, 0, sizeof journal_index);
+  return;
+}
+
+/* Return the index of SEC among the logged blocks, or -1 */
+static int
+journal_find(block_sector_t sec)
+{
+  ASSERT(lock_held_by_current_thread(&journal_lock));
+  for(size_t i = journal_hash(sec); journal_index[i] != 0;
+      i = (i + 1) % JOURNAL_INDEX_SIZE){
+    if(journal_home[journal_index[i] - 1] == sec){
+      return journal_index[i] - 1;
+    }
+  }
+  return -1;
+}
+
+/* Add the IDX-th logged block to the index by home sector */
+static void
+journal_index_add(size_t idx)
+{
+  ASSERT(lock_held_by_current_thread(&journal_lock));
+  size_t i = journal_hash(journal_home[idx]);
+  while(journal_index[i] != 0){
+    i = (i + 1) % JOURNAL_INDEX_SIZE;
+  }
+  journal_index[i] = idx + 1;
+  return;
+}
+
+/* Write a journal header recording CNT logged blocks */
+static void
+write_header(uint32_t cnt)
+{
+  static struct journal_header header;
+
+  ASSERT(sizeof header == BLOCK_SECTOR_SIZE);
+  header.magic = JOURNAL_MAGIC;
+  header.seq = journal_seq++;
+  header.cnt = cnt;
+  block_write(fs_device, JOURNAL_SECTOR, &header);
+  return;
+}
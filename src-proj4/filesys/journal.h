@@ -0,0 +1,37 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* On-disk journal region.  Sector JOURNAL_SECTOR holds the commit
+   header, followed by JOURNAL_DESC_SECTORS descriptor sectors
+   listing the home sector of every logged block, followed by the
+   logged blocks themselves. */
+#define JOURNAL_SECTOR 2                              /* First sector of the journal */
+#define JOURNAL_SECTORS 256                           /* Sectors in the journal region */
+#define JOURNAL_DESC_SECTORS 2                        /* Descriptor sectors */
+#define JOURNAL_CAPACITY (JOURNAL_SECTORS - 1 - JOURNAL_DESC_SECTORS)
+
+/* Most distinct metadata sectors a single outermost transaction
+   may log: an 8 MB file's inode and index sectors plus the free
+   map and a directory block. */
+#define JOURNAL_TXN_SECTORS 160
+
+/* Journal system operations */
+void journal_init(void);
+void journal_format(void);
+void journal_recover(void);
+void journal_flush(void);
+
+/* Transaction operations */
+void journal_begin(void);
+void journal_end(void);
+void journal_write(block_sector_t sec, const void* mem_addr);
+
+/* Hooks used by the buffer cache */
+bool journal_read(block_sector_t sec, void* mem_addr);
+bool journal_absorb(block_sector_t sec, const void* mem_addr);
+bool journal_contains(block_sector_t sec);
+
+#endif
@@ -0,0 +1,130 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Atomically stores NEW in *P if *P equals OLD.
+   Returns the old value of *P. */
+static inline int
+cmpxchg (int *p, int old, int new) 
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically stores NEW in *P.
+   Returns the old value of *P. */
+static inline int
+xchg (int *p, int new) 
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically adds V to *P.
+   Returns the old value of *P. */
+static inline int
+fetch_add (int *p, int v) 
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+  return v;
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m) 
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping in the kernel while another thread holds
+   it.  A thread that had to wait marks M contended (2) on its way
+   in, so the eventual mutex_unlock() knows to wake someone; that
+   may cost one spurious wake, never a lost one. */
+void
+mutex_lock (struct mutex *m) 
+{
+  int c = cmpxchg (&m->state, 0, 1);
+  if (c == 0)
+    return;
+
+  if (c != 2)
+    c = xchg (&m->state, 2);
+  while (c != 0) 
+    {
+      futex_wait (&m->state, 2);
+      c = xchg (&m->state, 2);
+    }
+}
+
+/* Tries to acquire M without sleeping.
+   Returns true if successful, false if M is held. */
+bool
+mutex_trylock (struct mutex *m) 
+{
+  return cmpxchg (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the caller must hold, waking one sleeper if
+   M was contended. */
+void
+mutex_unlock (struct mutex *m) 
+{
+  if (xchg (&m->state, 0) == 2)
+    futex_wake (&m->state, 1);
+}
+
+/* Initializes CV. */
+void
+condvar_init (struct condvar *cv) 
+{
+  cv->seq = 0;
+  cv->waiters = 0;
+}
+
+/* Atomically releases M and waits for CV to be signaled, then
+   reacquires M.  M must be held.  As with the kernel's
+   cond_wait(), the condition must be rechecked after waking.
+
+   A signal that comes between releasing M and sleeping changes
+   SEQ, so futex_wait() then returns at once instead of missing
+   it.  M is reacquired as contended, because other waiters may
+   be sleeping on it after a broadcast. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m) 
+{
+  int seq = cv->seq;
+
+  cv->waiters++;
+  mutex_unlock (m);
+  futex_wait (&cv->seq, seq);
+  while (xchg (&m->state, 2) != 0)
+    futex_wait (&m->state, 2);
+  cv->waiters--;
+}
+
+/* Wakes one thread waiting on CV, if any.  M must be held, which
+   lets a signal with no waiters skip the kernel. */
+void
+condvar_signal (struct condvar *cv, struct mutex *m UNUSED) 
+{
+  if (cv->waiters > 0) 
+    {
+      fetch_add (&cv->seq, 1);
+      futex_wake (&cv->seq, 1);
+    }
+}
+
+/* Wakes all threads waiting on CV.  M must be held. */
+void
+condvar_broadcast (struct condvar *cv, struct mutex *m UNUSED) 
+{
+  if (cv->waiters > 0) 
+    {
+      fetch_add (&cv->seq, 1);
+      futex_wake (&cv->seq, INT_MAX);
+    }
+}
@@ -182,3 +182,67 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+fsync (int fd) 
+{
+  return syscall1 (SYS_FSYNC, fd);
+}
+
+void
+sync (void) 
+{
+  syscall0 (SYS_SYNC);
+}
+
+void
+lockstats (void) 
+{
+  syscall0 (SYS_LOCKSTATS);
+}
+
+void
+memstats (void) 
+{
+  syscall0 (SYS_MEMSTATS);
+}
+
+int
+futex_wait (int *uaddr, int val) 
+{
+  return syscall2 (SYS_FUTEX_WAIT, uaddr, val);
+}
+
+int
+futex_wake (int *uaddr, int cnt) 
+{
+  return syscall2 (SYS_FUTEX_WAKE, uaddr, cnt);
+}
+
+/* Where a thread made by thread_create() starts: runs FUNC (AUX),
+   then ends the thread. */
+static void
+thread_start (void (*func) (void *aux), void *aux) 
+{
+  func (aux);
+  thread_exit ();
+}
+
+tid_t
+thread_create (void (*func) (void *aux), void *aux) 
+{
+  return syscall3 (SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+int
+thread_join (tid_t tid) 
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (void) 
+{
+  syscall0 (SYS_THREAD_EXIT);
+  NOT_REACHED ();
+}
@@ -0,0 +1,31 @@
+/* Writes a file, forces it to disk with fsync() and sync(), and
+   checks that the contents are intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 9876
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("durable", 0), "create \"durable\"");
+  CHECK ((fd = open ("durable")) > 1, "open \"durable\"");
+  CHECK (write (fd, buf, sizeof buf) == (int) sizeof buf,
+         "write \"durable\"");
+  CHECK (fsync (fd), "fsync \"durable\"");
+  CHECK (!fsync (fd + 1), "fsync unopened fd");
+  msg ("sync");
+  sync ();
+  msg ("close \"durable\"");
+  close (fd);
+  check_file ("durable", buf, sizeof buf);
+}
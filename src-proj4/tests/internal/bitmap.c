@@ -0,0 +1,143 @@
+/* Test program for bit searches in lib/kernel/bitmap.c.
+
+   Checks bitmap_scan() against a bit-at-a-time scan like the one
+   it replaced, on bitmaps of several sizes and fill ratios, and
+   prints how long each of the two takes.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Scans made per size and fill ratio. */
+#define SCAN_CNT 200
+
+static void fill (struct bitmap *, int percent);
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt,
+                         bool value);
+static void verify_next (struct bitmap *);
+
+/* Test and time bitmap scanning. */
+void
+test (void) 
+{
+  static const size_t sizes[] = {64, 1024, 16384, 131072};
+  static const int percents[] = {10, 50, 90, 99};
+  static const size_t cnts[] = {1, 8, 64};
+  size_t s;
+
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++) 
+    {
+      struct bitmap *b = bitmap_create (sizes[s]);
+      size_t p;
+
+      ASSERT (b != NULL);
+      for (p = 0; p < sizeof percents / sizeof *percents; p++) 
+        {
+          int64_t slow_ticks = 0, fast_ticks = 0;
+          size_t c;
+
+          fill (b, percents[p]);
+          for (c = 0; c < sizeof cnts / sizeof *cnts; c++) 
+            {
+              size_t expected[SCAN_CNT];
+              int64_t start;
+              int i;
+
+              start = timer_ticks ();
+              for (i = 0; i < SCAN_CNT; i++)
+                expected[i] = slow_scan (b, i * sizes[s] / SCAN_CNT,
+                                         cnts[c], false);
+              slow_ticks += timer_elapsed (start);
+
+              start = timer_ticks ();
+              for (i = 0; i < SCAN_CNT; i++)
+                ASSERT (bitmap_scan (b, i * sizes[s] / SCAN_CNT, cnts[c],
+                                     false) == expected[i]);
+              fast_ticks += timer_elapsed (start);
+            }
+          printf ("%zu bits, %d%% full: %"PRId64" ticks bit by bit, "
+                  "%"PRId64" ticks by words\n",
+                  sizes[s], percents[p], slow_ticks, fast_ticks);
+        }
+
+      verify_next (b);
+      bitmap_destroy (b);
+    }
+
+  printf ("bitmap: PASS\n");
+}
+
+/* Sets about PERCENT percent of the bits in B, in random runs, and
+   clears the rest. */
+static void
+fill (struct bitmap *b, int percent) 
+{
+  size_t i = 0;
+
+  bitmap_set_all (b, false);
+  while (i < bitmap_size (b)) 
+    {
+      size_t run = random_ulong () % 16 + 1;
+      bool value = (int) (random_ulong () % 100) < percent;
+
+      if (run > bitmap_size (b) - i)
+        run = bitmap_size (b) - i;
+      bitmap_set_multiple (b, i, run, value);
+      i += run;
+    }
+}
+
+/* Scans B the way bitmap_scan() used to, trying every start and
+   testing each bit of it. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  if (cnt <= bitmap_size (b)) 
+    {
+      size_t last = bitmap_size (b) - cnt;
+      size_t i, j;
+
+      for (i = start; i <= last; i++) 
+        {
+          for (j = 0; j < cnt; j++)
+            if (bitmap_test (b, i + j) != value)
+              break;
+          if (j == cnt)
+            return i;
+        }
+    }
+  return BITMAP_ERROR;
+}
+
+/* Checks that bitmap_scan_and_flip_next() hands out every clear
+   bit of B exactly once, wrapping around as needed. */
+static void
+verify_next (struct bitmap *b) 
+{
+  size_t clear_cnt, i;
+
+  fill (b, 50);
+  clear_cnt = bitmap_count (b, 0, bitmap_size (b), false);
+  for (i = 0; i < clear_cnt; i++) 
+    {
+      size_t idx = bitmap_scan_and_flip_next (b, 1, false);
+      ASSERT (idx != BITMAP_ERROR);
+      ASSERT (bitmap_test (b, idx));
+      if (random_ulong () % 4 == 0) 
+        {
+          bitmap_reset (b, idx);
+          i--;
+        }
+    }
+  ASSERT (bitmap_all (b, 0, bitmap_size (b)));
+  ASSERT (bitmap_scan_and_flip_next (b, 1, false) == BITMAP_ERROR);
+}
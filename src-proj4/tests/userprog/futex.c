@@ -0,0 +1,32 @@
+/* Checks futex_wait() and futex_wake() without contention, and
+   that a mutex and condition variable built on them work in a
+   single thread. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static int word = 1;
+  struct mutex m;
+  struct condvar cv;
+
+  CHECK (futex_wait (&word, 0) == -1, "futex_wait on a changed value");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake with no sleepers");
+
+  mutex_init (&m);
+  CHECK (mutex_trylock (&m), "mutex_trylock");
+  CHECK (!mutex_trylock (&m), "mutex_trylock while held");
+  mutex_unlock (&m);
+  mutex_lock (&m);
+  msg ("mutex_lock");
+
+  condvar_init (&cv);
+  condvar_signal (&cv, &m);
+  condvar_broadcast (&cv, &m);
+  msg ("condvar_signal and condvar_broadcast");
+  mutex_unlock (&m);
+}
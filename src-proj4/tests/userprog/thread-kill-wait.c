@@ -0,0 +1,44 @@
+/* Checks that exit() in the main thread ends threads that sleep
+   in the kernel for long: one waiting for a key on the console,
+   another in wait() for a child that never exits.  The process
+   still exits with the main thread's status. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static volatile int started;    /* Threads about to block. */
+
+static void
+reader (void *aux UNUSED) 
+{
+  char c;
+
+  started++;
+  read (STDIN_FILENO, &c, 1);
+  fail ("reader read a key");
+}
+
+static void
+waiter (void *aux UNUSED) 
+{
+  pid_t child = exec ("child-read");
+
+  started++;
+  wait (child);
+  fail ("waiter woke up");
+}
+
+void
+test_main (void) 
+{
+  CHECK (thread_create (reader, NULL) != TID_ERROR,
+         "thread_create reader");
+  CHECK (thread_create (waiter, NULL) != TID_ERROR,
+         "thread_create waiter");
+  while (started < 2)
+    continue;
+  msg ("exiting");
+  exit (57);
+}
@@ -0,0 +1,41 @@
+/* Checks that a fault in one thread ends the whole process: a
+   thread asleep on a futex and the main thread waiting to join
+   it must end too, and the process exits with status -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int never;               /* Nobody ever changes it. */
+static volatile int ready;      /* Set once the main thread joins. */
+
+static void
+sleeper (void *aux UNUSED) 
+{
+  futex_wait (&never, 0);
+  fail ("sleeper woke up");
+}
+
+static void
+faulter (void *aux UNUSED) 
+{
+  while (!ready)
+    continue;
+  *(volatile int *) NULL = 42;
+  fail ("faulter survived");
+}
+
+void
+test_main (void) 
+{
+  tid_t tid;
+
+  CHECK ((tid = thread_create (sleeper, NULL)) != TID_ERROR,
+         "thread_create sleeper");
+  CHECK (thread_create (faulter, NULL) != TID_ERROR,
+         "thread_create faulter");
+  msg ("joining sleeper");
+  ready = 1;
+  thread_join (tid);
+  fail ("main thread survived");
+}
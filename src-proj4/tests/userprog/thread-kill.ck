@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-kill) begin
+(thread-kill) thread_create sleeper
+(thread-kill) thread_create faulter
+(thread-kill) joining sleeper
+thread-kill: exit(-1)
+EOF
+pass;
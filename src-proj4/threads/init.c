@@ -21,6 +21,7 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -34,6 +35,7 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -52,6 +54,16 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -ramdisk, -ramswap: Sizes in sectors of the RAM disks to
+   create for the file system and swap roles, or 0 for none.
+   -ramdisk-load: Preload the file system RAM disk from the
+   scratch device? */
+static block_sector_t ramdisk_sectors;
+static bool ramdisk_load;
+#ifdef VM
+static block_sector_t ramswap_sectors;
+#endif
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
@@ -68,6 +80,7 @@ static void usage (void);
 #ifdef FILESYS
 static void locate_block_devices (void);
 static void locate_block_device (enum block_type, const char *name);
+static void create_ramdisks (void);
 #endif
 
 int main (void) NO_RETURN;
@@ -161,7 +174,8 @@ paging_init (void)
   size_t page;
   extern char _start, _end_kernel_text;
 
-  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                        | PAL_TAG (PAL_TAG_PAGEDIR));
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
     {
@@ -173,7 +187,8 @@ paging_init (void)
 
       if (pd[pde_idx] == 0)
         {
-          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                | PAL_TAG (PAL_TAG_PAGEDIR));
           pd[pde_idx] = pde_create (pt);
         }
 
@@ -247,15 +262,23 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_sectors = atoi (value);
+      else if (!strcmp (name, "-ramdisk-load"))
+        ramdisk_load = true;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-ramswap"))
+        ramswap_sectors = atoi (value);
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lockprof"))
+        lock_profiling = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -374,12 +397,16 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -ramdisk=SECTORS   Use a SECTORS-sector RAM disk for file system.\n"
+          "  -ramdisk-load      Preload file system RAM disk from scratch.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -ramswap=SECTORS   Use a SECTORS-sector RAM disk for swap.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lockprof          Profile contention on named kernel locks.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -392,13 +419,47 @@ usage (void)
 static void
 locate_block_devices (void)
 {
-  locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
+  /* The scratch device goes first because it may be the source
+     for preloading the file system RAM disk. */
   locate_block_device (BLOCK_SCRATCH, scratch_bdev_name);
+  create_ramdisks ();
+  locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
 #ifdef VM
   locate_block_device (BLOCK_SWAP, swap_bdev_name);
 #endif
 }
 
+/* Creates the RAM disks requested on the kernel command line.
+   A RAM disk takes its role in preference to any disk found by
+   probing, unless a device for that role was named explicitly. */
+static void
+create_ramdisks (void)
+{
+  if (ramdisk_sectors != 0)
+    {
+      struct block *preload = NULL;
+      if (ramdisk_load)
+        {
+          preload = block_get_role (BLOCK_SCRATCH);
+          if (preload == NULL)
+            PANIC ("-ramdisk-load given but no scratch device found");
+        }
+      ramdisk_create ("ram0", BLOCK_FILESYS, ramdisk_sectors, preload);
+      if (filesys_bdev_name == NULL)
+        filesys_bdev_name = "ram0";
+    }
+  else if (ramdisk_load)
+    PANIC ("-ramdisk-load requires -ramdisk");
+#ifdef VM
+  if (ramswap_sectors != 0)
+    {
+      ramdisk_create ("ram1", BLOCK_SWAP, ramswap_sectors, NULL);
+      if (swap_bdev_name == NULL)
+        swap_bdev_name = "ram1";
+    }
+#endif
+}
+
 /* Figures out what block device to use for the given ROLE: the
    block device with the given NAME, if NAME is non-null,
    otherwise the first block device in probe order of type
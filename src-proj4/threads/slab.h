@@ -0,0 +1,53 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Object cache.
+
+   A cache hands out objects of a single type.  It carves pages
+   from the page allocator, called "slabs", into as many objects
+   as fit, so that objects are packed at their own size instead of
+   being rounded up to a power of 2 as malloc() does, and objects
+   of the same type sit next to each other in memory. */
+
+/* Prepares a newly carved object for use.  An object is
+   constructed only once, when its slab is created; a cache with a
+   constructor expects objects to be freed in constructed state. */
+typedef void slab_ctor_func (void *object);
+
+/* An object cache. */
+struct slab_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Object size requested. */
+    size_t stride;              /* Bytes from one object to the next. */
+    size_t first_ofs;           /* Offset of the first object in a slab. */
+    size_t link_ofs;            /* Offset of free list link in an object. */
+    size_t obj_cnt;             /* Objects per slab. */
+    slab_ctor_func *ctor;       /* Constructor, or a null pointer. */
+
+    struct lock lock;           /* Protects the members below. */
+    struct list partial;        /* Slabs with objects both free and used. */
+    struct slab *spare;         /* An entirely free slab kept for reuse. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated. */
+    size_t in_use;              /* Objects allocated. */
+    size_t peak_in_use;         /* Highest IN_USE so far. */
+    uint64_t alloc_cnt;         /* Calls to slab_alloc() that succeeded. */
+    uint64_t fail_cnt;          /* Calls to slab_alloc() that failed. */
+
+    struct list_elem elem;      /* Element in list of all caches. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name, size_t size,
+                      size_t align, slab_ctor_func *);
+void *slab_alloc (struct slab_cache *) __attribute__ ((malloc));
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
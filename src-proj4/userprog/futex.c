@@ -0,0 +1,155 @@
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "userprog/futex.h"
+#include "userprog/pagedir.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Futex wait queues.  A user mutex or condition variable is an
+   int in user memory that user code updates with atomic
+   instructions, entering the kernel only to sleep until the int
+   changes or to wake threads sleeping on it.
+
+   Sleepers are kept in a fixed table of buckets hashed by
+   (page directory, user address), so threads sharing an address
+   space find each other while other processes using the same
+   virtual address do not. */
+#define FUTEX_BUCKETS 64
+
+/* A thread sleeping on a futex */
+struct futex_waiter{
+  uint32_t* pd;                 /* Page directory of the address */
+  int* uaddr;                   /* User address slept on */
+  struct semaphore sema;        /* Upped by the waker */
+  struct list_elem elem;        /* Element for the bucket's list */
+};
+
+/* A bucket of the futex table */
+struct futex_bucket{
+  struct lock lock;             /* Protects WAITERS and orders checks against wakes */
+  struct list waiters;          /* Sleeping threads, in order of arrival */
+};
+
+static struct futex_bucket futex_table[FUTEX_BUCKETS];
+
+static struct futex_bucket* futex_bucket_for(uint32_t* pd, int* uaddr);
+static bool futex_read(uint32_t* pd, int* uaddr, int* value);
+
+/* Initialize the futex table, should be used before any user process runs */
+void
+futex_init(void)
+{
+  for(int i = 0; i < FUTEX_BUCKETS; i ++){
+    lock_init(&futex_table[i].lock);
+    list_init(&futex_table[i].waiters);
+  }
+  return;
+}
+
+/* Sleep on UADDR in page directory PD if it still holds VAL.
+   The check and the enqueue happen under the bucket lock, which
+   every waker takes too, so a wake that follows a change of
+   *UADDR is never lost.  The check never faults, since a page
+   fault may sleep or end the process while the lock is held.
+   Returns FUTEX_CHANGED without sleeping if *UADDR differs from
+   VAL, or if the process is dying, since futex_queue_wake_all()
+   may already have passed; returns FUTEX_NOT_PRESENT if the page
+   of UADDR is not in memory, for the caller to fault it in and
+   retry.  UADDR must be an aligned user address */
+enum futex_result
+futex_queue_wait(uint32_t* pd, int* uaddr, int val)
+{
+  struct futex_bucket* b = futex_bucket_for(pd, uaddr);
+  struct futex_waiter w;
+  int value;
+
+  lock_acquire(&b->lock);
+  if(!futex_read(pd, uaddr, &value)){
+    lock_release(&b->lock);
+    return FUTEX_NOT_PRESENT;
+  }
+  if(value != val || thread_current()->main_t->dying){
+    lock_release(&b->lock);
+    return FUTEX_CHANGED;
+  }
+  w.pd = pd;
+  w.uaddr = uaddr;
+  sema_init(&w.sema, 0);
+  list_push_back(&b->waiters, &w.elem);
+  lock_release(&b->lock);
+
+  sema_down(&w.sema);
+  return FUTEX_WOKEN;
+}
+
+/* Wake up to CNT threads sleeping on UADDR in page directory PD,
+   oldest first.  Returns the number of threads woken */
+int
+futex_queue_wake(uint32_t* pd, int* uaddr, int cnt)
+{
+  struct futex_bucket* b = futex_bucket_for(pd, uaddr);
+  int woken = 0;
+
+  lock_acquire(&b->lock);
+  struct list_elem* iter = list_begin(&b->waiters);
+  while(iter != list_end(&b->waiters) && woken < cnt){
+    struct futex_waiter* w = list_entry(iter, struct futex_waiter, elem);
+    iter = list_next(iter);
+    if(w->pd == pd && w->uaddr == uaddr){
+      list_remove(&w->elem);    /* W lives on its sleeper's stack, drop it first */
+      sema_up(&w->sema);
+      woken ++;
+    }
+  }
+  lock_release(&b->lock);
+  return woken;
+}
+
+/* Wake up every thread sleeping on any address in page directory
+   PD, for a process that is dying */
+void
+futex_queue_wake_all(uint32_t* pd)
+{
+  for(int i = 0; i < FUTEX_BUCKETS; i ++){
+    struct futex_bucket* b = &futex_table[i];
+
+    lock_acquire(&b->lock);
+    struct list_elem* iter = list_begin(&b->waiters);
+    while(iter != list_end(&b->waiters)){
+      struct futex_waiter* w = list_entry(iter, struct futex_waiter, elem);
+      iter = list_next(iter);
+      if(w->pd == pd){
+        list_remove(&w->elem);  /* W lives on its sleeper's stack, drop it first */
+        sema_up(&w->sema);
+      }
+    }
+    lock_release(&b->lock);
+  }
+  return;
+}
+
+/* Read the int at UADDR in page directory PD into *VALUE through
+   the kernel mapping of its page, without faulting.  Interrupts
+   stay off so that the page is not evicted in between.  Returns
+   false if the page is not present */
+static bool
+futex_read(uint32_t* pd, int* uaddr, int* value)
+{
+  enum intr_level old_level = intr_disable();
+  int* kaddr = pagedir_get_page(pd, uaddr);
+  if(kaddr != NULL){
+    *value = *kaddr;
+  }
+  intr_set_level(old_level);
+  return kaddr != NULL;
+}
+
+/* Return the bucket of UADDR in page directory PD */
+static struct futex_bucket*
+futex_bucket_for(uint32_t* pd, int* uaddr)
+{
+  unsigned h = hash_bytes(&pd, sizeof pd) ^ hash_int((int)uaddr);
+  return &futex_table[h % FUTEX_BUCKETS];
+}
@@ -0,0 +1,24 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Initialization of futex wait queues, used in syscall_init() */
+void futex_init(void);
+
+/* Results of futex_queue_wait() */
+enum futex_result
+  {
+    FUTEX_WOKEN,                /* Slept until woken up */
+    FUTEX_CHANGED,              /* Did not hold the value, or the process is dying */
+    FUTEX_NOT_PRESENT           /* The page of the address is not in memory */
+  };
+
+/* Sleeping on and waking up a user address, keyed by the page
+   directory it is mapped in */
+enum futex_result futex_queue_wait(uint32_t* pd, int* uaddr, int val);
+int futex_queue_wake(uint32_t* pd, int* uaddr, int cnt);
+void futex_queue_wake_all(uint32_t* pd);
+
+#endif /* userprog/futex.h */
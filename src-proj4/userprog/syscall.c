@@ -11,13 +11,17 @@
 #include "filesys/filesys.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "devices/input.h"
 #include "threads/synch.h"
+#include "userprog/futex.h"
 
 typedef int pid_t;
 
 static int global_fd = 1;       /* fd generator */
 struct list file_list;          /* List for storing all opened files */
+static struct slab_cache file_des_cache;    /* File descriptors */
+struct slab_cache exit_code_cache;          /* Exit codes kept for parents */
 
 static void syscall_handler (struct intr_frame *);
 
@@ -25,8 +29,12 @@ void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init(&file_lock);        /* Initialize file_lock */
+  rwlock_init(&file_lock);      /* Initialize file_lock */
+  rwlock_set_name(&file_lock, "file_lock");
   list_init(&file_list);        /* Initialize file list */
+  slab_cache_init(&file_des_cache, "file_des", sizeof(struct file_des), 0, NULL);
+  slab_cache_init(&exit_code_cache, "exit_code", sizeof(struct exit_code_list_element), 0, NULL);
+  futex_init();                 /* Initialize futex wait queues */
 }
 
 /* Bad pointer checker */
@@ -80,7 +88,7 @@ clear_files(struct thread* t)
       else{
         file_close(fdes->file_ptr);
       }
-      free(fdes);
+      slab_free(&file_des_cache, fdes);
     }
     iter = next_iter;
   }
@@ -101,7 +109,7 @@ syscall_handler (struct intr_frame *f)
   
   /* Check the interrupt code is valid or not */
   int intr_code = *(int*)(f->esp);
-  if(intr_code < SYS_HALT || intr_code > SYS_INUMBER){
+  if(intr_code < SYS_HALT || intr_code > SYS_MEMSTATS){
     exit(-1);
   }
   
@@ -270,6 +278,79 @@ syscall_handler (struct intr_frame *f)
       f->eax = inumber(fd);
       break;
     }
+
+    case SYS_FSYNC:
+    {
+      /* parse the arguments first */
+      int fd = *((int*)(f->esp) + 1);
+
+      f->eax = fsync(fd);
+      break;
+    }
+
+    case SYS_SYNC:
+    {
+      sync();
+      break;
+    }
+
+    case SYS_LOCKSTATS:
+    {
+      lockstats();
+      break;
+    }
+
+    case SYS_MEMSTATS:
+    {
+      memstats();
+      break;
+    }
+
+    case SYS_FUTEX_WAIT:
+    {
+      /* parse the arguments first */
+      int* uaddr = (int*)*((int*)(f->esp) + 1);
+      int val = *((int*)(f->esp) + 2);
+
+      f->eax = futex_wait(uaddr, val);
+      break;
+    }
+
+    case SYS_FUTEX_WAKE:
+    {
+      /* parse the arguments first */
+      int* uaddr = (int*)*((int*)(f->esp) + 1);
+      int cnt = *((int*)(f->esp) + 2);
+
+      f->eax = futex_wake(uaddr, cnt);
+      break;
+    }
+
+    case SYS_THREAD_CREATE:
+    {
+      /* parse the arguments first */
+      void* eip = (void*)*((int*)(f->esp) + 1);
+      void* func = (void*)*((int*)(f->esp) + 2);
+      void* arg = (void*)*((int*)(f->esp) + 3);
+
+      f->eax = user_thread_create(eip, func, arg);
+      break;
+    }
+
+    case SYS_THREAD_JOIN:
+    {
+      /* parse the arguments first */
+      tid_t tid = *((int*)(f->esp) + 1);
+
+      f->eax = user_thread_join(tid);
+      break;
+    }
+
+    case SYS_THREAD_EXIT:
+    {
+      user_thread_exit();
+      break;
+    }
   }
 }
 
@@ -285,11 +366,20 @@ void
 exit(int status)
 {
   struct thread *cur = thread_current();
+
+  /* The whole process ends, with the status of its first exit() */
+  process_set_dying(status);
+  status = cur->main_t->exit_code;
   cur->exit_code = status;
 
+  /* The main thread reports it, the other threads end quietly */
+  if(cur->main_t != cur){
+    thread_exit();
+  }
+
   /* Construct a exit_code_element */
   if(cur->parent_t != NULL){
-    struct exit_code_list_element* exit_element = malloc(sizeof(struct exit_code_list_element));
+    struct exit_code_list_element* exit_element = slab_alloc(&exit_code_cache);
     exit_element->thread_tid = cur->tid;
     exit_element->thread_exit_code = status;
 
@@ -332,9 +422,9 @@ create(const char* file, unsigned initial_size)
   }
 
   /* Synchronization: only current thread access pointer file */
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
   int success = filesys_create(file, initial_size, false);
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
 
   return success;
 }
@@ -351,9 +441,9 @@ remove(const char* file)
   int success;
 
   /* Synchronization: only current thread access pointer file */
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
   success = filesys_remove(file);
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
 
   return success;
 }
@@ -368,7 +458,7 @@ open(const char* file)
   }  
 
   /* Synchronization: only current thread access pointer file */
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
   struct file *file_opened = filesys_open(file); 
   struct file_des* des;
 
@@ -376,7 +466,7 @@ open(const char* file)
     struct inode* inode = file_get_inode(file_opened);
     ASSERT(inode != NULL);
 
-    des = (struct file_des*)malloc(sizeof(struct file_des));
+    des = slab_alloc(&file_des_cache);
     des->file_ptr = file_opened;
     des->is_dir = inode_is_dir(inode);           /* Record the is_dir attribute */
     if(des->is_dir){
@@ -387,15 +477,15 @@ open(const char* file)
     }
     des->fd = ++global_fd;                       /* Set the fd */
     des->size = file_length(file_opened);        /* Set the size of file */
-    des->opener = thread_current();              /* Set the opener thread */
+    des->opener = thread_current()->main_t;      /* Set the opener process */
     list_push_back(&file_list, &(des->filelem)); /* Push this descriptor into list */
 
-    lock_release(&file_lock);
+    rwlock_release_write(&file_lock);
 
     return global_fd;
   }
   else{
-    lock_release(&file_lock);
+    rwlock_release_write(&file_lock);
     return -1;
   }
 }
@@ -425,8 +515,8 @@ read(int fd, void *buffer, unsigned size)
   struct file_des* f;
   int success = 0;
 
-  /* Synchronization: do read operation holding the file_lock */
-  lock_acquire(&file_lock);
+  /* Synchronization: do read operation holding the file_lock, readers share it */
+  rwlock_acquire_read(&file_lock);
 
   if(fd == STDOUT_FILENO){          /* READ syscall, do not support STDOUT */
     success = -1;
@@ -434,7 +524,9 @@ read(int fd, void *buffer, unsigned size)
   else if(fd == STDIN_FILENO){      /* If STDIN mode */
     void* ptr = buffer;
     while(!bad_ptr(ptr + 1) && (ptr - buffer) < size - 1){    /* check bad ptr or oversize */
-      *(uint8_t*)ptr = input_getc();
+      if(!input_getc_unless(process_is_dying, (uint8_t*)ptr)){ /* the process is dying, see process_set_dying() */
+        break;
+      }
       ptr ++;
     }
     *(uint8_t*)ptr = 0;                                       /* Fill the 0 at the end */
@@ -449,7 +541,7 @@ read(int fd, void *buffer, unsigned size)
       success = file_read(f->file_ptr, buffer, size);
     }
   }
-  lock_release(&file_lock);
+  rwlock_release_read(&file_lock);
   return success;
 }
 
@@ -465,7 +557,7 @@ write(int fd, const void *buffer, unsigned size)
   int res;
 
   /* Synchronization: do write operation holding the file_lock */
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
   
   if(fd == STDIN_FILENO){           /* WRITE syscall, do not support STDIN */
     res = -1;
@@ -484,7 +576,7 @@ write(int fd, const void *buffer, unsigned size)
     }
   }
 
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
   return res;
 }
 
@@ -492,7 +584,7 @@ write(int fd, const void *buffer, unsigned size)
 void
 seek(int fd, unsigned position)
 {
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
 
   struct file_des* f = find_des_by_fd(fd);    /* Find the target file descriptor */
   if(f == NULL){                              /* If no target file descriptor */
@@ -508,7 +600,7 @@ seek(int fd, unsigned position)
   }
 
 done:
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
   return;
 }
 
@@ -516,7 +608,7 @@ done:
 unsigned tell(int fd)
 {
   unsigned res;
-  lock_acquire(&file_lock);
+  rwlock_acquire_read(&file_lock);
 
   struct file_des* f = find_des_by_fd(fd);    /* Find the target file descriptor */
   if(f == NULL){                              /* If no target file descriptor */
@@ -534,7 +626,7 @@ unsigned tell(int fd)
   }
 
 done:
-  lock_release(&file_lock);
+  rwlock_release_read(&file_lock);
   return res;
 }
 
@@ -542,12 +634,12 @@ done:
 void
 close(int fd)
 {
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
 
   struct file_des *f = find_des_by_fd(fd);    /* Find the target file descriptor */
 
   /* Check the file is valid or not and check the closer is also the opener or not */
-  if(f == NULL || f->opener != thread_current() || f->file_ptr == NULL){
+  if(f == NULL || f->opener != thread_current()->main_t || f->file_ptr == NULL){
     goto done;
   }
   list_remove(&(f->filelem));
@@ -555,10 +647,10 @@ close(int fd)
   if(f->is_dir){
     dir_close(f->dir);
   }
-  free(f);
+  slab_free(&file_des_cache, f);
 
 done:
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
   return;
 }
 
@@ -571,9 +663,9 @@ chdir(const char *dir)
   }
 
   int success;
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
   success = filesys_change_dir(dir);
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
   return success;
 }
 
@@ -586,9 +678,9 @@ mkdir(const char *dir)
   }
 
   int success;
-  lock_acquire(&file_lock);
+  rwlock_acquire_write(&file_lock);
   success = filesys_create(dir, 0, true);
-  lock_release(&file_lock);
+  rwlock_release_write(&file_lock);
   return success;
 }
 
@@ -601,7 +693,7 @@ readdir(int fd, char *name)
   }
 
   bool success = false;
-  lock_acquire(&file_lock);
+  rwlock_acquire_read(&file_lock);
   struct file_des* f = find_des_by_fd(fd);
   if(f == NULL){
     goto done;
@@ -625,7 +717,7 @@ readdir(int fd, char *name)
   success = dir_readdir(dir, name);
 
 done:
-  lock_release(&file_lock);
+  rwlock_release_read(&file_lock);
   return success;
 }
 
@@ -633,9 +725,9 @@ done:
 int
 isdir(int fd)
 {
-  lock_acquire(&file_lock);
+  rwlock_acquire_read(&file_lock);
   struct file_des* f = find_des_by_fd(fd);
-  lock_release(&file_lock);
+  rwlock_release_read(&file_lock);
 
   if(f == NULL){
     exit(-1);
@@ -647,13 +739,127 @@ isdir(int fd)
 int
 inumber(int fd)
 {
-  lock_acquire(&file_lock);
+  rwlock_acquire_read(&file_lock);
   struct file_des* f = find_des_by_fd(fd);
   ASSERT(f != NULL);
 
   struct inode *inode = file_get_inode(f->file_ptr);
   ASSERT(inode != NULL);
-  lock_release(&file_lock);
+  rwlock_release_read(&file_lock);
 
   return inode_get_inumber(inode);
-}
\ No newline at end of file
+}
+
+/* syscall: write the file's dirty data and metadata to disk */
+int
+fsync(int fd)
+{
+  bool success = false;
+  rwlock_acquire_write(&file_lock);
+  struct file_des* f = find_des_by_fd(fd);
+  if(f == NULL){
+    goto done;
+  }
+
+  file_sync(f->file_ptr);
+  success = true;
+
+done:
+  rwlock_release_write(&file_lock);
+  return success;
+}
+
+/* syscall: write all dirty file system data to disk */
+void
+sync(void)
+{
+  rwlock_acquire_write(&file_lock);
+  filesys_sync();
+  rwlock_release_write(&file_lock);
+  return;
+}
+
+/* syscall: print contention statistics of the profiled kernel locks */
+void
+lockstats(void)
+{
+  lock_print_stats();
+  return;
+}
+
+/* syscall: print how kernel memory is used, by pool, allocation
+   tag, malloc() and slab cache */
+void
+memstats(void)
+{
+  palloc_print_stats();
+  malloc_print_stats();
+  slab_print_stats();
+  return;
+}
+
+/* syscall: sleep while *UADDR holds VAL, until futex_wake().
+   Returns 0 once woken, -1 if *UADDR did not hold VAL */
+int
+futex_wait(int* uaddr, int val)
+{
+  /* Check the word is valid and aligned */
+  if(bad_ptr((const char*)uaddr) || (uintptr_t)uaddr % sizeof(int) != 0){
+    exit(-1);
+  }
+
+  enum futex_result result = futex_queue_wait(thread_current()->pagedir, uaddr, val);
+  if(result == FUTEX_NOT_PRESENT){    /* Pages are never evicted, it is gone */
+    exit(-1);
+  }
+  return result == FUTEX_WOKEN ? 0 : -1;
+}
+
+/* syscall: wake up to CNT threads sleeping on UADDR.
+   Returns the number of threads woken */
+int
+futex_wake(int* uaddr, int cnt)
+{
+  /* UADDR is only a key here, it is never read */
+  if(uaddr == NULL || !is_user_vaddr(uaddr) || (uintptr_t)uaddr % sizeof(int) != 0){
+    exit(-1);
+  }
+
+  return futex_queue_wake(thread_current()->pagedir, uaddr, cnt);
+}
+
+/* syscall: start a thread in this process running EIP in user
+   mode, called with FUNC and ARG, on a stack of its own.  Returns
+   its tid, or -1 if it cannot be created */
+tid_t
+user_thread_create(void* eip, void* func, void* arg)
+{
+  /* A bad FUNC or ARG only hurts the new thread, but EIP must at
+     least be a user address */
+  if(eip == NULL || !is_user_vaddr(eip)){
+    exit(-1);
+  }
+  return process_thread_create((void (*) (void))eip, func, arg);
+}
+
+/* syscall: wait for thread TID of this process to exit.
+   Returns 0 once it has, -1 if TID cannot be joined */
+int
+user_thread_join(tid_t tid)
+{
+  return process_thread_join(tid);
+}
+
+/* syscall: end the calling thread.  For the main thread this
+   ends the process with status 0, after the other threads */
+void
+user_thread_exit(void)
+{
+  struct thread* cur = thread_current();
+
+  if(cur->main_t != cur){
+    thread_exit();
+  }
+  process_wait_threads();
+  exit(0);
+}
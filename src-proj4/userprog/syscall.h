@@ -1,10 +1,13 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include "threads/thread.h"
+#include "threads/slab.h"
 #include "filesys/directory.h"
 
 typedef int pid_t;
 
+extern struct slab_cache exit_code_cache;   /* Exit codes kept for parents */
+
 /* File descriptor */
 struct file_des
 {
@@ -13,11 +16,11 @@ struct file_des
   int is_dir;                         /* Record this fd is for a ordinary file or a directory */
   struct dir* dir;                    /* Pointer of the directory */
   struct file *file_ptr;              /* The pointer of this file */
-  struct thread* opener;              /* The thread open this file */
+  struct thread* opener;              /* Main thread of the process open this file */
   struct list_elem filelem;           /* Element for list */
 };
 
-struct lock file_lock;                /* Lock for file operations */
+struct rwlock file_lock;              /* Lock for file operations, reads share it */
 
 void syscall_init (void);
 
@@ -39,6 +42,15 @@ int mkdir(const char *dir);
 int readdir(int fd, char *name);
 int isdir(int fd);
 int inumber(int fd);
+int fsync(int fd);
+void sync(void);
+void lockstats(void);
+void memstats(void);
+int futex_wait(int* uaddr, int val);
+int futex_wake(int* uaddr, int cnt);
+tid_t user_thread_create(void* eip, void* func, void* arg);
+int user_thread_join(tid_t tid);
+void user_thread_exit(void);
 
 /* Helper functions */
 int bad_ptr(const char* file);